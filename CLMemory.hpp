@@ -16,6 +16,8 @@ template<typename T> class CLMemory {
 		}
 
 		~CLMemory() {
+			clReleaseMemObject(m_clMem);
+
 			if(m_bFree) {
 				delete [] m_pData;
 			}
@@ -51,6 +53,13 @@ template<typename T> class CLMemory {
 			}
 		}
 
+		void fill(const T & t) const {
+			auto res = clEnqueueFillBuffer(m_clQueue, m_clMem, &t, sizeof(T), 0, m_size, 0, NULL, NULL);
+			if( res != CL_SUCCESS ) {
+				throw std::runtime_error("clEnqueueFillBuffer failed - " + lexical_cast::write(res));
+			}
+		}
+
 		T * const & data() const {
 			return m_pData;
 		}
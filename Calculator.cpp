@@ -0,0 +1,320 @@
+#include "Calculator.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "ModeFactory.hpp"
+#include "sha3.hpp"
+
+// Bytes of input handed to the threads at a time
+#define ERADICATE2_COMPUTE_BLOCK (16 * 1024 * 1024)
+
+// Value of a hexadecimal digit, -1 for anything else. toHex() and hexValue() are too slow for millions of salts.
+static int nibbleValue(const char c) {
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	} else if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	} else if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+
+	return -1;
+}
+
+static void appendHex(std::string & s, const cl_uchar * const p, const size_t len) {
+	static const char szHex[] = "0123456789abcdef";
+
+	s += "0x";
+	for (size_t i = 0; i < len; ++i) {
+		s += szHex[p[i] >> 4];
+		s += szHex[p[i] & 0x0F];
+	}
+}
+
+static bool isSpace(const char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+Calculator::Config::Config() :
+	bCreate3(false),
+	bRaw(false),
+	threads(0)
+{
+
+}
+
+Calculator::Calculator(const Config & config) :
+	m_config(config),
+	m_threads(config.threads == 0 ? std::max(std::thread::hardware_concurrency(), 1U) : config.threads),
+	m_create2(),
+	m_create3(),
+	m_safe()
+{
+	if (config.strAddressBinary.size() != 20 || config.strInitCodeDigest.size() != 32) {
+		throw std::runtime_error("address must be 20 bytes and init code digest 32 bytes");
+	}
+
+	if (!config.strSafeInitializerDigest.empty() && config.strSafeInitializerDigest.size() != 32) {
+		throw std::runtime_error("Safe initializer digest must be 32 bytes");
+	}
+
+	// 0xff ++ address ++ salt ++ digest, 85 bytes in a single block
+	m_create2.b[0] = 0xff;
+	std::copy(config.strAddressBinary.begin(), config.strAddressBinary.end(), m_create2.b + 1);
+	std::copy(config.strInitCodeDigest.begin(), config.strInitCodeDigest.end(), m_create2.b + 53);
+	m_create2.b[85] ^= 0x01;
+	m_create2.b[135] ^= 0x80;
+
+	// rlp([proxy address, 1]), 23 bytes
+	m_create3.b[0] = 0xd6;
+	m_create3.b[1] = 0x94;
+	m_create3.b[22] = 0x01;
+	m_create3.b[23] ^= 0x01;
+	m_create3.b[135] ^= 0x80;
+
+	// keccak256(initializer) ++ saltNonce, 64 bytes
+	std::copy(config.strSafeInitializerDigest.begin(), config.strSafeInitializerDigest.end(), m_safe.b);
+	m_safe.b[64] ^= 0x01;
+	m_safe.b[135] ^= 0x80;
+}
+
+void Calculator::address(const cl_uchar * const pSalt, cl_uchar * const pAddress) const {
+	ethhash h = m_create2;
+	if (m_config.strSafeInitializerDigest.empty()) {
+		std::copy(pSalt, pSalt + 32, h.b + 21);
+	} else {
+		ethhash s = m_safe;
+		std::copy(pSalt, pSalt + 32, s.b + 32);
+		sha3_keccakf(s.q);
+		std::copy(s.b, s.b + 32, h.b + 21);
+	}
+
+	sha3_keccakf(h.q);
+
+	if (m_config.bCreate3) {
+		ethhash p = m_create3;
+		std::copy(h.b + 12, h.b + 32, p.b + 2);
+		sha3_keccakf(p.q);
+		h = p;
+	}
+
+	std::copy(h.b + 12, h.b + 32, pAddress);
+}
+
+cl_ulong Calculator::compute(const char * pBegin, const char * const pEnd, std::string & strOut) const {
+	cl_ulong count = 0;
+	cl_uchar salt[32];
+	cl_uchar hash[20];
+
+	strOut.reserve((pEnd - pBegin) / (m_config.bRaw ? 32 : 65) * (110 + 4 * m_config.vModes.size()));
+
+	while (pBegin < pEnd) {
+		if (m_config.bRaw) {
+			std::copy(pBegin, pBegin + 32, salt);
+			pBegin += 32;
+		} else {
+			// First column of a line is the salt, anything following it is ignored
+			const char * const pLine = pBegin;
+			const char * const pLineEnd = std::find(pBegin, pEnd, '\n');
+			pBegin = pLineEnd + (pLineEnd != pEnd);
+
+			const char * p = std::find_if(pLine, pLineEnd, [](const char c) { return !isSpace(c); });
+			if (p == pLineEnd) {
+				continue;
+			}
+
+			if (pLineEnd - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+				p += 2;
+			}
+
+			bool bValid = pLineEnd - p >= 64 && (pLineEnd - p == 64 || isSpace(p[64]));
+			for (int i = 0; i < 32 && bValid; ++i) {
+				const int hi = nibbleValue(p[2 * i]);
+				const int lo = nibbleValue(p[2 * i + 1]);
+				bValid = hi >= 0 && lo >= 0;
+				salt[i] = static_cast<cl_uchar>(hi * 16 + lo);
+			}
+
+			if (!bValid) {
+				throw std::runtime_error("bad salt \"" + std::string(pLine, std::find(pLine, pLineEnd, '\r')) + "\"");
+			}
+		}
+
+		address(salt, hash);
+
+		appendHex(strOut, salt, 32);
+		strOut += ' ';
+		appendHex(strOut, hash, 20);
+
+		const std::string strSalt(reinterpret_cast<const char *>(salt), 32);
+		const std::string strAddress(reinterpret_cast<const char *>(hash), 20);
+		for (auto & m : m_config.vModes) {
+			strOut += ' ';
+			strOut += std::to_string(ModeFactory::score(m, strAddress, strSalt));
+		}
+
+		strOut += '\n';
+		++count;
+	}
+
+	return count;
+}
+
+cl_ulong Calculator::runBlock(const char * const pBegin, const char * const pEnd, std::ostream & out) {
+	// Split at record boundaries, a line belongs to the part its first character is in
+	std::vector<const char *> vSplit(1, pBegin);
+	for (size_t i = 1; i < m_threads; ++i) {
+		const char * p = std::max(vSplit.back(), pBegin + (pEnd - pBegin) * i / m_threads);
+		if (m_config.bRaw) {
+			p = pBegin + (p - pBegin) / 32 * 32;
+		} else if (p != pBegin && p[-1] != '\n') {
+			p = std::find(p, pEnd, '\n');
+			p += p != pEnd;
+		}
+
+		vSplit.push_back(std::max(p, vSplit.back()));
+	}
+
+	vSplit.push_back(pEnd);
+
+	std::vector<std::string> vOut(m_threads);
+	std::vector<cl_ulong> vCount(m_threads, 0);
+	std::vector<std::exception_ptr> vException(m_threads);
+	std::vector<std::thread> vThreads;
+
+	for (size_t i = 0; i < m_threads; ++i) {
+		vThreads.push_back(std::thread([&, i]() {
+			try {
+				vCount[i] = compute(vSplit[i], vSplit[i + 1], vOut[i]);
+			} catch (...) {
+				vException[i] = std::current_exception();
+			}
+		}));
+	}
+
+	for (auto & t : vThreads) {
+		t.join();
+	}
+
+	cl_ulong count = 0;
+	for (size_t i = 0; i < m_threads; ++i) {
+		if (vException[i]) {
+			std::rethrow_exception(vException[i]);
+		}
+
+		out.write(vOut[i].data(), vOut[i].size());
+		count += vCount[i];
+	}
+
+	return count;
+}
+
+cl_ulong Calculator::run(std::istream & in, std::ostream & out) {
+	std::vector<char> vBlock(ERADICATE2_COMPUTE_BLOCK);
+	size_t size = 0;
+	cl_ulong count = 0;
+
+	while (in) {
+		in.read(vBlock.data() + size, vBlock.size() - size);
+		size += static_cast<size_t>(in.gcount());
+
+		// Whole records only, the rest is carried over to the next block
+		const char * const pBegin = vBlock.data();
+		const char * pEnd = pBegin + size;
+		if (m_config.bRaw) {
+			pEnd = pBegin + size / 32 * 32;
+		} else if (in) {
+			const char * const pLast = std::find(std::reverse_iterator<const char *>(pEnd), std::reverse_iterator<const char *>(pBegin), '\n').base();
+			if (pLast == pBegin) {
+				throw std::runtime_error("line longer than the compute block");
+			}
+
+			pEnd = pLast;
+		}
+
+		count += runBlock(pBegin, pEnd, out);
+
+		size = pBegin + size - pEnd;
+		std::memmove(vBlock.data(), pEnd, size);
+	}
+
+	if (size != 0) {
+		throw std::runtime_error("raw input is not a multiple of 32 bytes");
+	}
+
+	return count;
+}
+
+cl_ulong Calculator::run(const std::string & strFilename, std::ostream & out) {
+	if (strFilename == "-") {
+		return run(std::cin, out);
+	}
+
+#ifndef _WIN32
+	// Raw files are hashed straight from the page cache
+	if (m_config.bRaw) {
+		const int fd = open(strFilename.c_str(), O_RDONLY);
+		struct stat st;
+		if (fd == -1 || fstat(fd, &st) != 0) {
+			if (fd != -1) {
+				close(fd);
+			}
+
+			throw std::runtime_error("failed to open salt file \"" + strFilename + "\"");
+		}
+
+		const size_t size = static_cast<size_t>(st.st_size);
+		if (size % 32 != 0) {
+			close(fd);
+			throw std::runtime_error("raw input is not a multiple of 32 bytes");
+		}
+
+		if (size == 0) {
+			close(fd);
+			return 0;
+		}
+
+		void * const pMap = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (pMap == MAP_FAILED) {
+			throw std::runtime_error("failed to map salt file \"" + strFilename + "\"");
+		}
+
+		madvise(pMap, size, MADV_SEQUENTIAL);
+
+		const char * const pBegin = static_cast<const char *>(pMap);
+		cl_ulong count = 0;
+		try {
+			for (size_t offset = 0; offset < size; offset += ERADICATE2_COMPUTE_BLOCK) {
+				count += runBlock(pBegin + offset, pBegin + std::min<size_t>(offset + ERADICATE2_COMPUTE_BLOCK, size), out);
+			}
+		} catch (...) {
+			munmap(pMap, size);
+			throw;
+		}
+
+		munmap(pMap, size);
+		return count;
+	}
+#endif
+
+	std::ifstream ifs(strFilename, std::ios::in | std::ios::binary);
+	if (!ifs.is_open()) {
+		throw std::runtime_error("failed to open salt file \"" + strFilename + "\"");
+	}
+
+	return run(ifs, out);
+}
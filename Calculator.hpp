@@ -0,0 +1,55 @@
+#ifndef HPP_CALCULATOR
+#define HPP_CALCULATOR
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "types.hpp"
+
+/* Computes the CREATE2 addresses of known salts on the host, e.g. to audit the results of past runs or to score salts
+ * from other tools. Input is read in large blocks that are split between threads at record boundaries. Each thread
+ * hashes its records with sha3_keccakf() on a prepared state so only the salt lanes change between addresses, and
+ * formats its own output. Output keeps the order of the input, one line per salt:
+ *
+ *   0x<salt> 0x<address> [<score of each mode>]
+ */
+class Calculator {
+	public:
+		struct Config {
+			Config();
+
+			std::string strAddressBinary; // 20 byte deployer address
+			std::string strInitCodeDigest; // 32 byte keccak256 of the init code
+			bool bCreate3; // Output the CREATE3 address instead
+			std::string strSafeInitializerDigest; // Input is Safe saltNonces, the salt is keccak256(digest ++ saltNonce). Empty for plain salts.
+			std::vector<mode> vModes; // Each adds a score column
+			bool bRaw; // Input is raw 32 byte salts instead of hexadecimal lines
+			size_t threads; // 0 means one per hardware thread
+		};
+
+	public:
+		Calculator(const Config & config);
+
+		// Returns the number of salts. A file name of "-" reads standard input, raw files are memory mapped.
+		cl_ulong run(const std::string & strFilename, std::ostream & out);
+		cl_ulong run(std::istream & in, std::ostream & out);
+
+	private:
+		Calculator(Calculator & o);
+		Calculator & operator=(const Calculator & o);
+
+		cl_ulong runBlock(const char * const pBegin, const char * const pEnd, std::ostream & out);
+		cl_ulong compute(const char * pBegin, const char * const pEnd, std::string & strOut) const;
+		void address(const cl_uchar * const pSalt, cl_uchar * const pAddress) const;
+
+	private:
+		const Config m_config;
+		const size_t m_threads;
+		ethhash m_create2; // Preimage with the salt left zero, padded
+		ethhash m_create3; // RLP of the proxy address with the address left zero, padded
+		ethhash m_safe; // Initializer digest followed by the saltNonce left zero, padded
+};
+
+#endif /* HPP_CALCULATOR */
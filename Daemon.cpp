@@ -0,0 +1,490 @@
+#include "Daemon.hpp"
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <algorithm>
+#include <cctype>
+#include <random>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <signal.h>
+#endif
+
+#include "ModeFactory.hpp"
+#include "hexadecimal.hpp"
+#include "lexical_cast.hpp"
+
+// Parses a flat JSON object, nested objects and arrays are not supported. Values are returned as their
+// string contents or, for numbers and literals, their raw text.
+static bool parseJsonObject(const std::string & s, std::map<std::string, std::string> & m) {
+	size_t i = 0;
+	auto skipSpace = [&]() { while (i < s.size() && isspace(static_cast<unsigned char>(s[i]))) ++i; };
+	auto readString = [&](std::string & out) {
+		if (i >= s.size() || s[i] != '"') {
+			return false;
+		}
+
+		for (++i; i < s.size() && s[i] != '"'; ++i) {
+			if (s[i] == '\\' && i + 1 < s.size()) {
+				++i;
+				out += (s[i] == 'n' ? '\n' : s[i] == 't' ? '\t' : s[i]);
+			} else {
+				out += s[i];
+			}
+		}
+
+		return i++ < s.size();
+	};
+
+	skipSpace();
+	if (i >= s.size() || s[i++] != '{') {
+		return false;
+	}
+
+	skipSpace();
+	if (i < s.size() && s[i] == '}') {
+		return true;
+	}
+
+	while (i < s.size()) {
+		std::string strKey;
+		std::string strValue;
+
+		skipSpace();
+		if (!readString(strKey)) {
+			return false;
+		}
+
+		skipSpace();
+		if (i >= s.size() || s[i++] != ':') {
+			return false;
+		}
+
+		skipSpace();
+		if (i < s.size() && s[i] == '"') {
+			if (!readString(strValue)) {
+				return false;
+			}
+		} else {
+			while (i < s.size() && s[i] != ',' && s[i] != '}' && !isspace(static_cast<unsigned char>(s[i]))) {
+				strValue += s[i++];
+			}
+		}
+
+		m[strKey] = strValue;
+
+		skipSpace();
+		if (i < s.size() && s[i] == ',') {
+			++i;
+		} else if (i < s.size() && s[i] == '}') {
+			return true;
+		} else {
+			return false;
+		}
+	}
+
+	return false;
+}
+
+static std::string jsonString(const std::string & s) {
+	std::string r = "\"";
+	for (const char c : s) {
+		if (c == '"' || c == '\\') {
+			r += '\\';
+			r += c;
+		} else if (c == '\n') {
+			r += "\\n";
+		} else if (static_cast<unsigned char>(c) >= 0x20) {
+			r += c;
+		}
+	}
+
+	return r + "\"";
+}
+
+template <typename T> static T jsonValue(const std::map<std::string, std::string> & m, const std::string & strKey, const T & def) {
+	const auto it = m.find(strKey);
+	return it == m.end() ? def : lexical_cast::read<T>(it->second);
+}
+
+class Daemon::Connection {
+	public:
+		Connection(const int fd) : m_fd(fd) {}
+
+		~Connection() {
+#ifndef _WIN32
+			close(m_fd);
+#endif
+		}
+
+		void send(const std::string & strLine) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+#ifndef _WIN32
+			const std::string strData = strLine + "\n";
+			size_t offset = 0;
+			while (offset < strData.size()) {
+				const auto res = ::write(m_fd, strData.data() + offset, strData.size() - offset);
+				if (res <= 0) {
+					break; // Client went away, the job keeps running until it finishes
+				}
+
+				offset += res;
+			}
+#endif
+		}
+
+		const int m_fd;
+
+	private:
+		std::mutex m_mutex;
+};
+
+Daemon::JobState::JobState() :
+	id(0),
+	priority(0),
+	bDeadline(false),
+	bCancelled(false),
+	scoreBest(0)
+{
+
+}
+
+Daemon::Daemon(SearchEngine & engine, const std::string & strSocketPath) :
+	m_engine(engine),
+	m_strSocketPath(strSocketPath),
+	m_socket(-1),
+	m_nextId(1),
+	m_speed(0)
+{
+
+}
+
+Daemon::~Daemon() {
+#ifndef _WIN32
+	if (m_socket != -1) {
+		close(m_socket);
+		unlink(m_strSocketPath.c_str());
+	}
+#endif
+}
+
+void Daemon::run() {
+#ifdef _WIN32
+	throw std::runtime_error("daemon mode requires Unix domain sockets");
+#else
+	signal(SIGPIPE, SIG_IGN);
+
+	sockaddr_un addr = sockaddr_un();
+	addr.sun_family = AF_UNIX;
+	if (m_strSocketPath.size() >= sizeof(addr.sun_path)) {
+		throw std::runtime_error("socket path too long");
+	}
+
+	std::copy(m_strSocketPath.begin(), m_strSocketPath.end(), addr.sun_path);
+
+	m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_socket == -1) {
+		throw std::runtime_error("failed to create socket");
+	}
+
+	unlink(m_strSocketPath.c_str());
+	if (bind(m_socket, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(m_socket, 16) != 0) {
+		throw std::runtime_error("failed to listen on \"" + m_strSocketPath + "\"");
+	}
+
+	std::cout << "Listening on " << m_strSocketPath << std::endl;
+
+	std::thread threadSchedule(&Daemon::schedule, this);
+	threadSchedule.detach();
+
+	acceptLoop();
+#endif
+}
+
+void Daemon::acceptLoop() {
+#ifndef _WIN32
+	for (;;) {
+		const int fd = accept(m_socket, NULL, NULL);
+		if (fd == -1) {
+			continue;
+		}
+
+		std::shared_ptr<Connection> pConnection = std::make_shared<Connection>(fd);
+		std::thread(&Daemon::handleConnection, this, pConnection).detach();
+	}
+#endif
+}
+
+void Daemon::handleConnection(std::shared_ptr<Connection> pConnection) {
+#ifndef _WIN32
+	std::string strBuffer;
+	char buf[4096];
+
+	for (;;) {
+		const auto res = ::read(pConnection->m_fd, buf, sizeof(buf));
+		if (res <= 0) {
+			break;
+		}
+
+		strBuffer.append(buf, res);
+
+		size_t pos;
+		while ((pos = strBuffer.find('\n')) != std::string::npos) {
+			const std::string strLine = strBuffer.substr(0, pos);
+			strBuffer.erase(0, pos + 1);
+
+			if (strLine.find_first_not_of(" \t\r") != std::string::npos) {
+				handleRequest(pConnection, strLine);
+			}
+		}
+	}
+#endif
+}
+
+void Daemon::handleRequest(std::shared_ptr<Connection> pConnection, const std::string & strLine) {
+	std::map<std::string, std::string> m;
+	if (!parseJsonObject(strLine, m)) {
+		emit(pConnection, "{\"event\":\"error\",\"message\":\"malformed request\"}");
+		return;
+	}
+
+	const std::string strOp = jsonValue<std::string>(m, "op", "");
+
+	try {
+		if (strOp == "submit") {
+			JobPtr pJob = std::make_shared<JobState>();
+			pJob->strTag = m.count("tag") ? m["tag"] : "";
+			pJob->job.strAddressBinary = parseHexadecimalBytes(jsonValue<std::string>(m, "address", ""));
+			if (m.count("initCodeHash")) {
+				pJob->job.strInitCodeDigest = parseHexadecimalBytes(m["initCodeHash"]);
+			} else {
+				pJob->job.strInitCodeDigest = SearchEngine::keccakDigest(parseHexadecimalBytes(m.count("initCode") ? m["initCode"] : ""));
+			}
+
+			if (m.count("saltTemplate")) {
+				SearchEngine::parseSaltTemplate(m["saltTemplate"], pJob->job.strSaltTemplate, pJob->job.strSaltVariable);
+			}
+
+			if (m.count("constraint")) {
+				SearchEngine::parseConstraint(m["constraint"], pJob->job.strConstraintMask, pJob->job.strConstraintValue);
+			}
+
+			if (m.count("safeInitializer")) {
+				if (!pJob->job.strSaltVariable.empty()) {
+					throw std::runtime_error("safeInitializer can't be combined with saltTemplate");
+				}
+
+				pJob->job.strSafeInitializerDigest = SearchEngine::keccakDigest(parseHexadecimalBytes(m["safeInitializer"]));
+			}
+
+			if (pJob->job.strAddressBinary.size() != 20 || pJob->job.strInitCodeDigest.size() != 32) {
+				throw std::runtime_error("address must be 20 bytes and init code hash 32 bytes");
+			}
+
+			const int min = jsonValue<int>(m, "min", 0);
+			const int max = jsonValue<int>(m, "max", 0);
+
+			// Comma separated list of modes, each optionally followed by :<arg> which overrides "arg"
+			std::istringstream issModes(jsonValue<std::string>(m, "mode", ""));
+			std::string strMode;
+			while (std::getline(issModes, strMode, ',')) {
+				const size_t pos = strMode.find(':');
+				const std::string strName = strMode.substr(0, pos);
+				const std::string strArg = pos == std::string::npos ? (m.count("arg") ? m["arg"] : "") : strMode.substr(pos + 1);
+				pJob->job.vModes.push_back(ModeFactory::parse(strName, strArg, min, max));
+				pJob->vModeNames.push_back(strName);
+			}
+
+			if (pJob->job.vModes.empty() || pJob->job.vModes.size() > ERADICATE2_MAX_MODES) {
+				throw std::runtime_error("between 1 and " + lexical_cast::write(ERADICATE2_MAX_MODES) + " modes required");
+			}
+
+			pJob->vScoreBest.assign(pJob->job.vModes.size(), 0);
+			pJob->job.bCreate3 = m.count("create3") && (m["create3"] == "true" || m["create3"] == "1");
+			pJob->job.scoreTarget = std::min(jsonValue<int>(m, "target", 0), ERADICATE2_MAX_SCORE);
+
+			// A fixed seed keeps the salts of the job the same when it's preempted, resuming past the rounds it covered
+			std::random_device rd;
+			pJob->job.seed = (static_cast<cl_ulong>(rd()) << 32) | rd();
+			pJob->priority = jsonValue<int>(m, "priority", 0);
+			pJob->pConnection = pConnection;
+			pJob->timeSubmit = std::chrono::steady_clock::now();
+
+			const double deadline = jsonValue<double>(m, "deadline", 0);
+			if (deadline > 0) {
+				pJob->bDeadline = true;
+				pJob->timeDeadline = pJob->timeSubmit + std::chrono::milliseconds(static_cast<long long>(deadline * 1000));
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				pJob->id = m_nextId++;
+				m_vQueue.push_back(pJob);
+			}
+
+			emit(pJob, "{\"event\":\"accepted\",\"job\":" + lexical_cast::write(pJob->id) + ",\"tag\":" + jsonString(pJob->strTag) + "}");
+			m_cvSchedule.notify_all();
+		} else if (strOp == "cancel") {
+			const unsigned int id = jsonValue<unsigned int>(m, "job", 0);
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			bool bFound = false;
+			for (auto & pJob : m_vQueue) {
+				if (pJob->id == id) {
+					pJob->bCancelled = bFound = true;
+				}
+			}
+
+			if (m_pRunning && m_pRunning->id == id) {
+				m_pRunning->bCancelled = bFound = true;
+			}
+
+			if (!bFound) {
+				emit(pConnection, "{\"event\":\"error\",\"message\":\"unknown job\",\"job\":" + lexical_cast::write(id) + "}");
+			}
+
+			m_cvSchedule.notify_all();
+		} else if (strOp == "status") {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::ostringstream oss;
+			oss << "{\"event\":\"status\",\"running\":" << (m_pRunning ? lexical_cast::write(m_pRunning->id) : "null") << ",\"queued\":" << m_vQueue.size() << ",\"speed\":" << std::fixed << std::setprecision(0) << m_speed.load() << "}";
+			emit(pConnection, oss.str());
+		} else {
+			emit(pConnection, "{\"event\":\"error\",\"message\":\"unknown op\"}");
+		}
+	} catch (std::runtime_error & e) {
+		emit(pConnection, "{\"event\":\"error\",\"message\":" + jsonString(e.what()) + "}");
+	}
+}
+
+void Daemon::schedule() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for (;;) {
+		m_cvSchedule.wait_for(lock, std::chrono::milliseconds(10));
+		const auto now = std::chrono::steady_clock::now();
+
+		// Highest priority first, submission order within the same priority
+		std::stable_sort(m_vQueue.begin(), m_vQueue.end(), [](const JobPtr & a, const JobPtr & b) { return a->priority > b->priority; });
+
+		if (m_pRunning) {
+			JobPtr pJob = m_pRunning;
+			const bool bExpired = pJob->bDeadline && now >= pJob->timeDeadline;
+			const bool bPreempt = !m_vQueue.empty() && m_vQueue.front()->priority > pJob->priority;
+
+			if (!m_engine.running()) {
+				// Delivers the results still being verified or scored on the host
+				m_engine.wait();
+				m_pRunning.reset();
+				finishJob(pJob, "target");
+			} else if (pJob->bCancelled || bExpired || bPreempt) {
+				// Result callbacks never take m_mutex so waiting for the devices here can't deadlock
+				m_engine.stop();
+				m_engine.wait();
+				m_pRunning.reset();
+
+				if (pJob->bCancelled) {
+					finishJob(pJob, "cancelled");
+				} else if (bExpired) {
+					finishJob(pJob, "deadline");
+				} else {
+					// Resume above the best score of each mode and with salts not hashed yet
+					pJob->job.vScoreMax.assign(pJob->vScoreBest.begin(), pJob->vScoreBest.end());
+					pJob->job.roundBase += m_engine.rounds();
+					m_vQueue.push_back(pJob);
+					emit(pJob, "{\"event\":\"preempted\",\"job\":" + lexical_cast::write(pJob->id) + "}");
+				}
+			}
+		}
+
+		// Drop queued jobs that were cancelled or ran out of time before getting a turn
+		for (auto it = m_vQueue.begin(); it != m_vQueue.end();) {
+			JobPtr pJob = *it;
+			if (pJob->bCancelled || (pJob->bDeadline && now >= pJob->timeDeadline)) {
+				it = m_vQueue.erase(it);
+				finishJob(pJob, pJob->bCancelled ? "cancelled" : "deadline");
+			} else {
+				++it;
+			}
+		}
+
+		if (!m_pRunning && !m_vQueue.empty()) {
+			m_pRunning = m_vQueue.front();
+			m_vQueue.erase(m_vQueue.begin());
+			startJob(m_pRunning);
+		}
+	}
+}
+
+void Daemon::startJob(JobPtr pJob) {
+	emit(pJob, "{\"event\":\"started\",\"job\":" + lexical_cast::write(pJob->id) + "}");
+
+	auto resultCallback = [this, pJob](const result & r, const cl_uchar score, const size_t modeIndex, const size_t deviceIndex) {
+		if (score <= pJob->vScoreBest[modeIndex]) {
+			return;
+		}
+
+		const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - pJob->timeSubmit).count();
+		pJob->vScoreBest[modeIndex] = score;
+		pJob->scoreBest = std::max<unsigned int>(pJob->scoreBest, score);
+
+		// Safe jobs find a saltNonce, the salt is derived from it
+		std::string strSalt(reinterpret_cast<const char *>(r.salt), 32);
+		std::ostringstream oss;
+		oss << "{\"event\":\"result\",\"job\":" << pJob->id << ",\"mode\":" << jsonString(pJob->vModeNames[modeIndex]) << ",\"score\":" << static_cast<int>(score);
+		if (!pJob->job.strSafeInitializerDigest.empty()) {
+			oss << ",\"saltNonce\":\"0x" << toHex(r.salt, 32) << "\"";
+			strSalt = SearchEngine::safeSalt(pJob->job.strSafeInitializerDigest, strSalt);
+		}
+
+		oss << ",\"salt\":\"0x" << toHex(reinterpret_cast<const uint8_t *>(strSalt.data()), 32) << "\",\"address\":\"0x" << toHex(r.hash, 20) << "\"";
+		if (pJob->job.bCreate3) {
+			const std::string strProxy = SearchEngine::create2Address(pJob->job.strAddressBinary, strSalt, pJob->job.strInitCodeDigest);
+			oss << ",\"proxy\":\"0x" << toHex(reinterpret_cast<const uint8_t *>(strProxy.data()), 20) << "\"";
+		}
+
+		const mode & m = pJob->job.vModes[modeIndex];
+		if (m.function == ModeFunction::Gas) {
+			oss << ",\"gas\":" << SearchEngine::gasSaved(r, m.data1[0] != 0);
+		}
+
+		oss << ",\"device\":" << deviceIndex << ",\"time\":" << std::fixed << std::setprecision(3) << seconds << "}";
+		emit(pJob, oss.str());
+	};
+
+	auto progressCallback = [this](const Speed & speed) {
+		m_speed = speed.getSpeed();
+	};
+
+	try {
+		m_engine.start(pJob->job, resultCallback, progressCallback);
+	} catch (std::runtime_error & e) {
+		m_pRunning.reset();
+		emit(pJob, "{\"event\":\"error\",\"job\":" + lexical_cast::write(pJob->id) + ",\"message\":" + jsonString(e.what()) + "}");
+	}
+}
+
+void Daemon::finishJob(JobPtr pJob, const std::string & strReason) {
+	emit(pJob, "{\"event\":\"finished\",\"job\":" + lexical_cast::write(pJob->id) + ",\"reason\":" + jsonString(strReason) + ",\"score\":" + lexical_cast::write(pJob->scoreBest.load()) + "}");
+}
+
+void Daemon::emit(JobPtr pJob, const std::string & strJson) {
+	emit(pJob->pConnection, strJson);
+}
+
+void Daemon::emit(std::shared_ptr<Connection> pConnection, const std::string & strJson) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutexOutput);
+		std::cout << strJson << std::endl;
+	}
+
+	if (pConnection) {
+		pConnection->send(strJson);
+	}
+}
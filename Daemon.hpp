@@ -0,0 +1,88 @@
+#ifndef HPP_DAEMON
+#define HPP_DAEMON
+
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <map>
+
+#include "SearchEngine.hpp"
+
+/* Long running job server. Listens on a Unix domain socket for newline separated JSON requests and
+ * runs the submitted jobs one at a time on the devices of an already initialized SearchEngine, so a
+ * new job never pays for platform initialization or kernel compilation.
+ *
+ * Requests:
+ *   {"op":"submit", "address":"0x..", "initCode":"0x.." or "initCodeHash":"0x..", "mode":"leading,zeros,mirror",
+ *    "arg":"0", "min":0, "max":0, "saltTemplate":"0x..xx", "create3":true, "target":8, "deadline":60, "priority":0,
+ *    "tag":"..."}
+ *   {"op":"cancel", "job":1}
+ *   {"op":"status"}
+ *
+ * Every event is written as a JSON line both to the submitting connection and to stdout. A job with
+ * higher priority preempts the running one, which is requeued and resumes reporting above the best
+ * score it already found, past the salts it already hashed. Deadlines are in seconds from submission. Several comma separated modes score
+ * the same hashes, "name:arg" gives a mode its own argument.
+ */
+class Daemon {
+	private:
+		class Connection;
+
+		struct JobState {
+			JobState();
+
+			unsigned int id;
+			std::string strTag;
+			SearchEngine::Job job;
+			int priority;
+			std::chrono::time_point<std::chrono::steady_clock> timeSubmit;
+			std::chrono::time_point<std::chrono::steady_clock> timeDeadline;
+			bool bDeadline;
+			bool bCancelled;
+			std::atomic<unsigned int> scoreBest; // Best over all modes
+			std::vector<unsigned int> vScoreBest; // Only touched from result callbacks and while the job isn't running
+			std::vector<std::string> vModeNames;
+			std::shared_ptr<Connection> pConnection;
+		};
+
+		typedef std::shared_ptr<JobState> JobPtr;
+
+	public:
+		Daemon(SearchEngine & engine, const std::string & strSocketPath);
+		~Daemon();
+
+		void run();
+
+	private:
+		Daemon(Daemon & o);
+		Daemon & operator=(const Daemon & o);
+
+		void acceptLoop();
+		void handleConnection(std::shared_ptr<Connection> pConnection);
+		void handleRequest(std::shared_ptr<Connection> pConnection, const std::string & strLine);
+		void schedule();
+
+		void startJob(JobPtr pJob);
+		void finishJob(JobPtr pJob, const std::string & strReason);
+		void emit(JobPtr pJob, const std::string & strJson);
+		void emit(std::shared_ptr<Connection> pConnection, const std::string & strJson);
+
+	private:
+		SearchEngine & m_engine;
+		const std::string m_strSocketPath;
+		int m_socket;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cvSchedule;
+		std::vector<JobPtr> m_vQueue;
+		JobPtr m_pRunning;
+		unsigned int m_nextId;
+		std::atomic<double> m_speed;
+		std::mutex m_mutexOutput;
+};
+
+#endif /* HPP_DAEMON */
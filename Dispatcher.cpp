@@ -9,21 +9,9 @@
 #include <random>
 #include <thread>
 #include <algorithm>
+#include <climits>
 #include "hexadecimal.hpp"
 
-static void printResult(const result r, const cl_uchar score, const std::chrono::time_point<std::chrono::steady_clock> & timeStart) {
-	// Time delta
-	const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - timeStart).count();
-
-	// Format address
-	const std::string strSalt = toHex(r.salt, 32);
-	const std::string strPublic = toHex(r.hash, 20);
-
-	// Print
-	const std::string strVT100ClearLine = "\33[2K\r";
-	std::cout << strVT100ClearLine << "  Time: " << std::setw(5) << seconds << "s Score: " << std::setw(2) << (int) score << " Salt: 0x" << strSalt << " Address: 0x" << strPublic << std::endl;
-}
-
 Dispatcher::OpenCLException::OpenCLException(const std::string s, const cl_int res) :
 	std::runtime_error( s + " (res = " + lexical_cast::write(res) + ")"),
 	m_res(res)
@@ -37,16 +25,17 @@ void Dispatcher::OpenCLException::OpenCLException::throwIfError(const std::strin
 	}
 }
 
-cl_command_queue Dispatcher::Device::createQueue(cl_context & clContext, cl_device_id & clDeviceId) {
+cl_command_queue Dispatcher::Device::createQueue(cl_context & clContext, cl_device_id & clDeviceId, const bool bProfiling) {
 	// nVidia CUDA Toolkit 10.1 only supports OpenCL 1.2 so we revert back to older functions for compatability
 #ifdef ERADICATE2_DEBUG
 	cl_command_queue_properties p = CL_QUEUE_PROFILING_ENABLE;
 #else
-	cl_command_queue_properties p = 0;
+	cl_command_queue_properties p = bProfiling ? CL_QUEUE_PROFILING_ENABLE : 0;
 #endif
 
 #ifdef CL_VERSION_2_0
-	const cl_command_queue ret = clCreateCommandQueueWithProperties(clContext, clDeviceId, &p, NULL);
+	const cl_queue_properties vProperties[] = { CL_QUEUE_PROPERTIES, p, 0 };
+	const cl_command_queue ret = clCreateCommandQueueWithProperties(clContext, clDeviceId, vProperties, NULL);
 #else
 	const cl_command_queue ret = clCreateCommandQueue(clContext, clDeviceId, p, NULL);
 #endif
@@ -58,159 +47,808 @@ cl_kernel Dispatcher::Device::createKernel(cl_program & clProgram, const std::st
 	return ret == NULL ? throw std::runtime_error("failed to create kernel \"" + s + "\"") : ret;
 }
 
-Dispatcher::Device::Device(Dispatcher & parent, cl_context & clContext, cl_program & clProgram, cl_device_id clDeviceId, const size_t worksizeLocal, const size_t size, const size_t index) :
+Dispatcher::Device::Device(Dispatcher & parent, cl_context & clContext, cl_program & clProgram, cl_device_id clDeviceId, const size_t worksizeLocal, const size_t worksizeMax, const size_t size, const size_t index) :
 	m_parent(parent),
 	m_index(index),
+	m_clContext(clContext),
+	m_clProgram(clProgram),
 	m_clDeviceId(clDeviceId),
 	m_worksizeLocal(worksizeLocal),
+	m_worksizeMax(worksizeMax == 0 ? size : worksizeMax),
+	m_size(size),
 	m_clScoreMax(0),
-	m_clQueue(createQueue(clContext, clDeviceId) ),
+	m_clQueue(createQueue(clContext, clDeviceId, parent.m_pTrace != NULL || parent.paced())),
 	m_kernelIterate(createKernel(clProgram, "eradicate2_iterate")),
-	m_memResult(clContext, m_clQueue, CL_MEM_READ_WRITE, ERADICATE2_MAX_SCORE + 1),
-	m_memMode(clContext, m_clQueue, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, 1),
-	m_round(0)
+	m_kernelNoop(createKernel(clProgram, "eradicate2_noop")),
+	m_memResult(clContext, m_clQueue, CL_MEM_READ_WRITE, (ERADICATE2_MAX_SCORE + 1) * ERADICATE2_MAX_MODES),
+	m_memMode(clContext, m_clQueue, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, ERADICATE2_MAX_MODES + 1),
+	m_memJob(clContext, m_clQueue, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, 1),
+	m_memHistogram(clContext, m_clQueue, CL_MEM_READ_WRITE, (ERADICATE2_MAX_SCORE + 1) * ERADICATE2_MAX_MODES),
+	m_memCandidateCount(clContext, m_clQueue, CL_MEM_READ_WRITE, 1),
+	m_memCandidates(clContext, m_clQueue, CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, ERADICATE2_MAX_CANDIDATES),
+	m_round(0),
+	m_bExcluded(false),
+	m_bFailed(false),
+	m_failures(0),
+	m_clEvent(NULL),
+	m_traceOffset(LLONG_MAX),
+	m_vHistogramLast((ERADICATE2_MAX_SCORE + 1) * ERADICATE2_MAX_MODES, 0),
+	m_vHistogram((ERADICATE2_MAX_SCORE + 1) * ERADICATE2_MAX_MODES, 0),
+	m_histogramHashes(0),
+	m_sizeRound(size),
+	m_hashesEnqueued(0),
+	m_paceRate(0),
+	m_paceRateBest(0),
+	m_paceBackoff(1)
 {
 
 }
 
 Dispatcher::Device::~Device() {
+	// Reads into the host buffers may still be queued, e.g. on a device that failed. The error of a broken queue is of no
+	// interest here.
+	clFinish(m_clQueue);
+
+	for (auto & e : m_vTraceEvents) {
+		clReleaseEvent(e.second);
+	}
+
+	for (auto & p : m_qPaceEvents) {
+		for (auto & event : p.second) {
+			clReleaseEvent(event);
+		}
+	}
+
+	clReleaseKernel(m_kernelIterate);
+	clReleaseKernel(m_kernelNoop);
+	clReleaseCommandQueue(m_clQueue);
+}
+
+Dispatcher::Histogram::Histogram() :
+	hashes(0)
+{
 
 }
 
-Dispatcher::Dispatcher(cl_context & clContext, cl_program & clProgram, const size_t worksizeMax, const size_t size)
-	: m_clContext(clContext), m_clProgram(clProgram), m_worksizeMax(worksizeMax), m_size(size), m_clScoreMax(0), m_eventFinished(NULL), m_countPrint(0) {
+Dispatcher::Dispatcher(const DispatchModel dispatchModel, const bool bHistogram, FailureCallback failureCallback, Trace * const pTrace, const double dutyCycle, const bool bYield)
+	: m_dispatchModel(dutyCycle < 1 || bYield ? DispatchModel::Thread : dispatchModel), m_pTrace(pTrace), m_bHistogram(bHistogram), m_dutyCycle(dutyCycle), m_bYield(bYield), m_bNoop(false), m_roundLimit(0), m_clScoreTarget(0), m_countPrint(0), m_countRunning(0), m_quit(false), m_failureCallback(failureCallback) {
 
 }
 
 Dispatcher::~Dispatcher() {
+	stop();
+	wait();
 
+	for (auto it = m_vDevices.begin(); it != m_vDevices.end(); ++it) {
+		delete *it;
+	}
 }
 
-void Dispatcher::addDevice(cl_device_id clDeviceId, const size_t worksizeLocal, const size_t index) {
-	Device * pDevice = new Device(*this, m_clContext, m_clProgram, clDeviceId, worksizeLocal, m_size, index);
+void Dispatcher::addDevice(cl_context & clContext, cl_program & clProgram, cl_device_id clDeviceId, const size_t worksizeLocal, const size_t worksizeMax, const size_t size, const size_t index) {
+	Device * pDevice = new Device(*this, clContext, clProgram, clDeviceId, worksizeLocal, worksizeMax, size, index);
 	m_vDevices.push_back(pDevice);
 }
 
-void Dispatcher::run(const mode & mode) {
-	m_eventFinished = clCreateUserEvent(m_clContext, NULL);
-	timeStart = std::chrono::steady_clock::now();
+void Dispatcher::start(const std::vector<mode> & vModes, const job & job, const cl_uint deviceIndexBase, const std::vector<cl_ulong> & vInitCode, const std::vector<cl_uchar> & vScoreMax, const cl_uchar scoreTarget, ResultCallback resultCallback, ProgressCallback progressCallback, const mode & modeCandidate, CandidateCallback candidateCallback) {
+	if (running()) {
+		throw std::runtime_error("dispatcher is already running");
+	}
+
+	if (vModes.empty() || vModes.size() > ERADICATE2_MAX_MODES || vScoreMax.size() != vModes.size()) {
+		throw std::runtime_error("between 1 and " + lexical_cast::write(ERADICATE2_MAX_MODES) + " modes can be searched at once");
+	}
+
+	m_vScoreMax = vScoreMax;
+	m_clScoreTarget = scoreTarget;
+	m_resultCallback = resultCallback;
+	m_progressCallback = progressCallback;
+	m_candidateCallback = job.candidateScore ? candidateCallback : nullptr;
+	m_speed.clear();
+
+	deviceRecover();
 
 	for (auto it = m_vDevices.begin(); it != m_vDevices.end(); ++it) {
-		Device & d = **it;
-		d.m_round = 0;
+		if ((*it)->m_bExcluded || (*it)->m_bFailed) {
+			continue;
+		}
 
-		for (size_t i = 0; i < ERADICATE2_MAX_SCORE + 1; ++i) {
-			d.m_memResult[i].found = 0;
+		try {
+			deviceSetup(**it, vModes, job, deviceIndexBase, vInitCode, vScoreMax, modeCandidate);
+		} catch (std::runtime_error & e) {
+			deviceFail(**it, e.what());
 		}
+	}
 
-		// Copy data
-		*d.m_memMode = mode;
-		d.m_memMode.write(true);
-		d.m_memResult.write(true);
+	launch();
+}
 
-		// Kernel arguments - eradicate2_iterate
-		d.m_memResult.setKernelArg(d.m_kernelIterate, 0);
-		d.m_memMode.setKernelArg(d.m_kernelIterate, 1);
-		CLMemory<cl_uchar>::setKernelArg(d.m_kernelIterate, 2, d.m_clScoreMax); // Updated in handleResult()		
-		CLMemory<cl_uint>::setKernelArg(d.m_kernelIterate, 3, d.m_index);
-		// Round information updated in deviceDispatch()
+// Failed devices whose backoff has passed are created anew on the same context and program, the old queue, kernels
+// and buffers are released once whatever the failed device still had queued has finished.
+void Dispatcher::deviceRecover() {
+	for (auto it = m_vDevices.begin(); it != m_vDevices.end(); ++it) {
+		Device * const pDevice = *it;
+		if (!pDevice->m_bFailed || pDevice->m_bExcluded || std::chrono::steady_clock::now() < pDevice->m_timeRetry) {
+			continue;
+		}
+
+		try {
+			Device * const pDeviceNew = new Device(*this, pDevice->m_clContext, pDevice->m_clProgram, pDevice->m_clDeviceId, pDevice->m_worksizeLocal, pDevice->m_worksizeMax, pDevice->m_size, pDevice->m_index);
+			pDeviceNew->m_failures = pDevice->m_failures;
+			delete pDevice;
+			*it = pDeviceNew;
+		} catch (std::runtime_error & e) {
+			// Counts as another failure
+			pDevice->m_bFailed = false;
+			deviceFail(*pDevice, e.what());
+		}
+	}
+}
+
+Dispatcher::Device & Dispatcher::device(const size_t deviceIndex) {
+	for (auto it = m_vDevices.begin(); it != m_vDevices.end(); ++it) {
+		if ((*it)->m_index == deviceIndex) {
+			return **it;
+		}
+	}
+
+	throw std::runtime_error("no device with index " + lexical_cast::write(deviceIndex));
+}
+
+void Dispatcher::deviceSetup(Device & d, const std::vector<mode> & vModes, const job & job, const cl_uint deviceIndexBase, const std::vector<cl_ulong> & vInitCode, const std::vector<cl_uchar> & vScoreMax, const mode & modeCandidate) {
+	d.m_round = 0;
+	d.m_memMode[vModes.size()] = modeCandidate;
+	*d.m_memCandidateCount = 0;
+	d.m_clScoreMax = 0;
+
+	for (size_t k = 0; k < vModes.size(); ++k) {
+		d.m_clScoreMax |= static_cast<cl_ulong>(vScoreMax[k]) << (8 * k);
+		d.m_memMode[k] = vModes[k];
+	}
+
+	for (size_t i = 0; i < (ERADICATE2_MAX_SCORE + 1) * ERADICATE2_MAX_MODES; ++i) {
+		d.m_memResult[i].found = 0;
+		d.m_memHistogram[i] = 0;
+		d.m_vHistogramLast[i] = 0;
+		d.m_vHistogram[i] = 0;
+	}
+	d.m_histogramHashes = 0;
+
+	// Paced rounds start small, the first measured kernel tells how long a round of the device may be
+	const size_t granularity = std::max<size_t>(d.m_worksizeLocal, 1);
+	paceClear(d);
+	d.m_sizeRound = paced() ? std::min(d.m_size, std::max(d.m_size / 64 / granularity, static_cast<size_t>(1)) * granularity) : d.m_size;
+	d.m_hashesEnqueued = 0;
+	d.m_timeEnqueue = std::chrono::steady_clock::now();
+	d.m_timePace = d.m_timeEnqueue;
+	d.m_paceRate = 0;
+	d.m_paceRateBest = 0;
+	d.m_paceBackoff = 1;
+
+	// Copy data
+	*d.m_memJob = job;
+	d.m_memJob->modeCount = static_cast<cl_uint>(vModes.size());
+	d.m_memJob->candidateMax = ERADICATE2_MAX_CANDIDATES;
+	d.m_memMode.write(true);
+	d.m_memJob.write(true);
+	d.m_memResult.write(true);
+	d.m_memHistogram.write(true);
+	d.m_memCandidateCount.write(true);
+
+	// Kernel arguments must be valid buffers even when the init code isn't varied
+	d.m_pMemInitCode.reset(new CLMemory<cl_ulong>(d.m_clContext, d.m_clQueue, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, std::max<size_t>(vInitCode.size(), 1)));
+	(*d.m_pMemInitCode)[0] = 0;
+	std::copy(vInitCode.begin(), vInitCode.end(), d.m_pMemInitCode->data());
+	d.m_pMemInitCode->write(true);
+
+	// Kernel arguments - eradicate2_iterate
+	d.m_memResult.setKernelArg(d.m_kernelIterate, 0);
+	d.m_memMode.setKernelArg(d.m_kernelIterate, 1);
+	d.m_memJob.setKernelArg(d.m_kernelIterate, 2);
+	CLMemory<cl_ulong>::setKernelArg(d.m_kernelIterate, 3, d.m_clScoreMax); // Updated in handleResult()
+	CLMemory<cl_uint>::setKernelArg(d.m_kernelIterate, 4, static_cast<cl_uint>(deviceIndexBase + d.m_index));
+	// Round information updated in deviceDispatch()
+	d.m_memHistogram.setKernelArg(d.m_kernelIterate, 6);
+	d.m_memCandidateCount.setKernelArg(d.m_kernelIterate, 7);
+	d.m_memCandidates.setKernelArg(d.m_kernelIterate, 8);
+	d.m_pMemInitCode->setKernelArg(d.m_kernelIterate, 9);
+}
+
+std::vector<result> Dispatcher::runOnce(const size_t deviceIndex, const std::vector<mode> & vModes, const job & job, const std::vector<cl_ulong> & vInitCode, const size_t size) {
+	if (running()) {
+		throw std::runtime_error("dispatcher is already running");
+	}
+
+	if (vModes.empty() || vModes.size() > ERADICATE2_MAX_MODES) {
+		throw std::runtime_error("between 1 and " + lexical_cast::write(ERADICATE2_MAX_MODES) + " modes can be searched at once");
+	}
+
+	Device & d = device(deviceIndex);
+	::job jobOnce = job;
+	jobOnce.candidateScore = 0;
+	deviceSetup(d, vModes, jobOnce, 0, vInitCode, std::vector<cl_uchar>(vModes.size(), 0), mode());
+
+	CLMemory<cl_uint>::setKernelArg(d.m_kernelIterate, 5, ++d.m_round);
+	enqueueKernelDevice(d, d.m_kernelIterate, size, NULL, NULL);
+	d.m_memResult.read(true);
+
+	return std::vector<result>(d.m_memResult.data(), d.m_memResult.data() + vModes.size() * (ERADICATE2_MAX_SCORE + 1));
+}
+
+void Dispatcher::exclude(const size_t deviceIndex) {
+	device(deviceIndex).m_bExcluded = true;
+}
+
+std::map<size_t, double> Dispatcher::benchmarkRoundTrip(const DispatchModel dispatchModel, const cl_uint rounds) {
+	if (running()) {
+		throw std::runtime_error("dispatcher is already running");
+	}
+
+	const DispatchModel dispatchModelPrevious = m_dispatchModel;
+	m_dispatchModel = dispatchModel;
+	m_bNoop = true;
+	m_roundLimit = rounds;
+
+	// Nothing is scored so no result is ever above the maximum
+	m_vScoreMax.assign(1, ERADICATE2_MAX_SCORE);
+	m_clScoreTarget = 0;
+	m_resultCallback = nullptr;
+	m_progressCallback = nullptr;
+	m_candidateCallback = nullptr;
+	m_speed.clear();
+
+	for (auto it = m_vDevices.begin(); it != m_vDevices.end(); ++it) {
+		(*it)->m_round = 0;
+	}
+
+	const auto timeStart = std::chrono::steady_clock::now();
+	launch();
+	wait();
+
+	m_dispatchModel = dispatchModelPrevious;
+	m_bNoop = false;
+	m_roundLimit = 0;
+
+	std::map<size_t, double> mRoundTrip;
+	for (auto it = m_vDevices.begin(); it != m_vDevices.end(); ++it) {
+		if ((*it)->m_bExcluded || (*it)->m_bFailed) {
+			continue;
+		}
+
+		const std::chrono::duration<double> seconds = (*it)->m_timeFinish - timeStart;
+		mRoundTrip[(*it)->m_index] = seconds.count() / rounds;
 	}
-	
-	m_quit = false;
-	m_countRunning = m_vDevices.size();
 
-	std::cout << "Running..." << std::endl;
-	std::cout << std::endl;
+	return mRoundTrip;
+}
+
+void Dispatcher::launch() {
+	joinThreads();
+
+	m_quit = false;
+	m_countRunning = std::count_if(m_vDevices.begin(), m_vDevices.end(), [](const Device * pDevice) { return !pDevice->m_bExcluded && !pDevice->m_bFailed; });
+	if (m_countRunning == 0) {
+		throw std::runtime_error("every device has been excluded");
+	}
 
 	// Start asynchronous dispatch loop on all devices
+	switch (m_dispatchModel) {
+	case DispatchModel::Callback:
+		for (auto it = m_vDevices.begin(); it != m_vDevices.end(); ++it) {
+			if (!(*it)->m_bExcluded && !(*it)->m_bFailed) {
+				deviceDispatch(*(*it));
+			}
+		}
+		break;
+
+	case DispatchModel::Thread:
+		for (auto it = m_vDevices.begin(); it != m_vDevices.end(); ++it) {
+			if (!(*it)->m_bExcluded && !(*it)->m_bFailed) {
+				m_vThreads.push_back(std::thread(&Dispatcher::threadDevice, this, std::ref(**it)));
+			}
+		}
+		break;
+
+	case DispatchModel::Poll:
+		m_vThreads.push_back(std::thread(&Dispatcher::threadPoll, this));
+		break;
+	}
+}
+
+// Dispatch threads exit on their own once their devices leave the dispatch loop
+void Dispatcher::joinThreads() {
+	for (auto & t : m_vThreads) {
+		t.join();
+	}
+
+	m_vThreads.clear();
+}
+
+void Dispatcher::threadDevice(Device & d) {
+	deviceDispatch(d);
+
+	while (d.m_clEvent != NULL) {
+		cl_event event = d.m_clEvent;
+		d.m_clEvent = NULL;
+
+		const auto res = clWaitForEvents(1, &event);
+		clReleaseEvent(event);
+		if (res != CL_SUCCESS) {
+			deviceFailed(d, "failed to wait for event (res = " + lexical_cast::write(res) + ")");
+			return;
+		}
+
+		deviceDispatch(d);
+	}
+}
+
+void Dispatcher::threadPoll() {
+	for (auto it = m_vDevices.begin(); it != m_vDevices.end(); ++it) {
+		if (!(*it)->m_bExcluded && !(*it)->m_bFailed) {
+			deviceDispatch(*(*it));
+		}
+	}
+
+	for (bool bPending = true; bPending; ) {
+		bool bDispatched = false;
+		bPending = false;
+
+		for (auto it = m_vDevices.begin(); it != m_vDevices.end(); ++it) {
+			Device & d = **it;
+			if (d.m_clEvent == NULL) {
+				continue;
+			}
+
+			cl_int status;
+			const auto res = clGetEventInfo(d.m_clEvent, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, NULL);
+
+			if (res != CL_SUCCESS || status < 0) {
+				clReleaseEvent(d.m_clEvent);
+				d.m_clEvent = NULL;
+				deviceFailed(d, "bad event status (res = " + lexical_cast::write(res) + ", status = " + lexical_cast::write(status) + ")");
+			} else if (status == CL_COMPLETE) {
+				clReleaseEvent(d.m_clEvent);
+				d.m_clEvent = NULL;
+				deviceDispatch(d);
+				bDispatched = true;
+			}
+
+			bPending = bPending || d.m_clEvent != NULL;
+		}
+
+		if (!bDispatched) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void Dispatcher::stop() {
+	m_quit = true;
+}
+
+void Dispatcher::wait() {
+	// Wait until every device has left the dispatch loop. Devices may live in different contexts so a
+	// single OpenCL user event can't be used to signal this.
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cvFinished.wait(lock, [&] { return m_countRunning == 0; });
+	}
+
+	joinThreads();
+
+	// The last round of each device is still in flight when it leaves the loop. A failed device is left alone.
+	for (auto it = m_vDevices.begin(); it != m_vDevices.end(); ++it) {
+		Device & d = **it;
+		if (d.m_bFailed) {
+			continue;
+		}
+
+		clFinish(d.m_clQueue);
+		paceClear(d);
+
+		if (m_pTrace) {
+			traceFlush(d);
+		}
+
+		if (m_bHistogram && d.m_round > 0) {
+			d.m_memHistogram.read(true);
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			histogramUpdate(d, d.m_hashesEnqueued);
+		}
+
+		if (m_candidateCallback && d.m_round > 0 && !d.m_bExcluded) {
+			d.m_memCandidateCount.read(true);
+			d.m_memCandidates.read(true);
+			candidatesHandle(d);
+		}
+	}
+
+	// Every candidate has been delivered, waiting again mustn't repeat the last round
+	m_candidateCallback = nullptr;
+}
+
+bool Dispatcher::running() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_countRunning != 0;
+}
+
+void Dispatcher::raiseScoreMax(const size_t modeIndex, const cl_uchar score) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (modeIndex < m_vScoreMax.size() && score > m_vScoreMax[modeIndex]) {
+		m_vScoreMax[modeIndex] = score;
+	}
+}
+
+Dispatcher::Histogram Dispatcher::histogram(const size_t deviceIndex) {
+	Histogram h;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto it = m_vDevices.begin(); it != m_vDevices.end(); ++it) {
+		const Device & d = **it;
+		if (d.m_index == deviceIndex) {
+			h.hashes = d.m_histogramHashes;
+			h.vCount.assign(d.m_vHistogram.begin(), d.m_vHistogram.begin() + (ERADICATE2_MAX_SCORE + 1) * m_vScoreMax.size());
+		}
+	}
+
+	return h;
+}
+
+cl_uint Dispatcher::rounds() {
+	cl_uint r = 0;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
 	for (auto it = m_vDevices.begin(); it != m_vDevices.end(); ++it) {
-		deviceDispatch(*(*it));
+		r = std::max(r, (*it)->m_round);
 	}
 
-	// Wait for finish event
-	clWaitForEvents(1, &m_eventFinished);
-	clReleaseEvent(m_eventFinished);
-	m_eventFinished = NULL;
+	return r;
 }
 
-void Dispatcher::enqueueKernel(cl_command_queue & clQueue, cl_kernel & clKernel, size_t worksizeGlobal, const size_t worksizeLocal, cl_event * pEvent = NULL) {
-	const size_t worksizeMax = m_worksizeMax;
+// Must be called with m_mutex held, hashes is the number of hashes of the kernel rounds the last histogram read covers
+void Dispatcher::histogramUpdate(Device & d, const cl_ulong hashes) {
+	for (size_t i = 0; i < d.m_vHistogram.size(); ++i) {
+		const cl_uint count = d.m_memHistogram[i];
+		d.m_vHistogram[i] += static_cast<cl_uint>(count - d.m_vHistogramLast[i]);
+		d.m_vHistogramLast[i] = count;
+	}
+
+	d.m_histogramHashes = hashes;
+}
+
+void Dispatcher::candidatesHandle(Device & d) {
+	const size_t count = *d.m_memCandidateCount;
+	const size_t countStored = std::min<size_t>(count, ERADICATE2_MAX_CANDIDATES);
+
+	if (count > 0) {
+		m_candidateCallback(d.m_memCandidates.data(), countStored, count - countStored, d.m_index);
+	}
+}
+
+// The event of every enqueued part is appended to pvEvents if given
+void Dispatcher::enqueueKernel(cl_command_queue & clQueue, cl_kernel & clKernel, size_t worksizeGlobal, const size_t worksizeLocal, const size_t worksizeMax, std::vector<cl_event> * pvEvents = NULL) {
 	size_t worksizeOffset = 0;
 	while (worksizeGlobal) {
 		const size_t worksizeRun = std::min(worksizeGlobal, worksizeMax);
 		const size_t * const pWorksizeLocal = (worksizeLocal == 0 ? NULL : &worksizeLocal);
-		const auto res = clEnqueueNDRangeKernel(clQueue, clKernel, 1, &worksizeOffset, &worksizeRun, pWorksizeLocal, 0, NULL, pEvent);
+		cl_event event;
+		const auto res = clEnqueueNDRangeKernel(clQueue, clKernel, 1, &worksizeOffset, &worksizeRun, pWorksizeLocal, 0, NULL, pvEvents == NULL ? NULL : &event);
 		OpenCLException::throwIfError("kernel queueing failed", res);
 
+		if (pvEvents != NULL) {
+			pvEvents->push_back(event);
+		}
+
 		worksizeGlobal -= worksizeRun;
 		worksizeOffset += worksizeRun;
 	}
 }
 
-void Dispatcher::enqueueKernelDevice(Device & d, cl_kernel & clKernel, size_t worksizeGlobal, cl_event * pEvent = NULL) {
+// With a trace the kernel is recorded on the queue lane as szTrace. The events of its parts are appended to pvEvents if
+// given, the caller releases them.
+void Dispatcher::enqueueKernelDevice(Device & d, cl_kernel & clKernel, size_t worksizeGlobal, const char * const szTrace = NULL, std::vector<cl_event> * const pvEvents = NULL) {
+	Trace::Scope scope(m_pTrace, "enqueue", d.m_index);
+	std::vector<cl_event> vEvents;
+	std::vector<cl_event> * const pvEventsAll = (m_pTrace && szTrace) || pvEvents ? &vEvents : NULL;
+
 	try {
-		enqueueKernel(d.m_clQueue, clKernel, worksizeGlobal, d.m_worksizeLocal, pEvent);
+		enqueueKernel(d.m_clQueue, clKernel, worksizeGlobal, d.m_worksizeLocal, d.m_worksizeMax, pvEventsAll);
 	} catch ( OpenCLException & e ) {
 		// If local work size is invalid, abandon it and let implementation decide
 		if ((e.m_res == CL_INVALID_WORK_GROUP_SIZE || e.m_res == CL_INVALID_WORK_ITEM_SIZE) && d.m_worksizeLocal != 0) {
 			std::cout << std::endl << "warning: local work size abandoned on GPU" << d.m_index << std::endl;
 			d.m_worksizeLocal = 0;
-			enqueueKernel(d.m_clQueue, clKernel, worksizeGlobal, d.m_worksizeLocal, pEvent);
+			enqueueKernel(d.m_clQueue, clKernel, worksizeGlobal, d.m_worksizeLocal, d.m_worksizeMax, pvEventsAll);
 		}
 		else {
 			throw;
 		}
 	}
+
+	for (auto & event : vEvents) {
+		if (pvEvents != NULL) {
+			pvEvents->push_back(event);
+		}
+
+		if (m_pTrace && szTrace && (pvEvents == NULL || clRetainEvent(event) == CL_SUCCESS)) {
+			d.m_vTraceEvents.push_back(std::make_pair(szTrace, event));
+		}
+	}
+}
+
+// Turns the profiled commands of a device that have completed into spans of its queue lane. Device timestamps are
+// mapped to host time with the smallest difference seen between a completion on the device and the host noticing it.
+void Dispatcher::traceFlush(Device & d) {
+	const long long now = Trace::now();
+	std::vector<std::pair<const char *, cl_event>> vPending;
+	std::vector<std::pair<const char *, std::pair<cl_ulong, cl_ulong>>> vComplete;
+
+	for (auto & e : d.m_vTraceEvents) {
+		cl_int status = CL_COMPLETE;
+		clGetEventInfo(e.second, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, NULL);
+		if (status > CL_COMPLETE) {
+			vPending.push_back(e);
+			continue;
+		}
+
+		cl_ulong timeStart, timeEnd;
+		if (status == CL_COMPLETE && clGetEventProfilingInfo(e.second, CL_PROFILING_COMMAND_START, sizeof(timeStart), &timeStart, NULL) == CL_SUCCESS && clGetEventProfilingInfo(e.second, CL_PROFILING_COMMAND_END, sizeof(timeEnd), &timeEnd, NULL) == CL_SUCCESS) {
+			vComplete.push_back(std::make_pair(e.first, std::make_pair(timeStart, timeEnd)));
+			d.m_traceOffset = std::min(d.m_traceOffset, now - static_cast<long long>(timeEnd));
+		}
+
+		clReleaseEvent(e.second);
+	}
+
+	d.m_vTraceEvents.swap(vPending);
+
+	for (auto & c : vComplete) {
+		m_pTrace->span(c.first, static_cast<unsigned int>(d.m_index), Trace::Queue, static_cast<long long>(c.second.first) + d.m_traceOffset, static_cast<long long>(c.second.second) + d.m_traceOffset);
+	}
+}
+
+bool Dispatcher::paced() const {
+	return m_dutyCycle < 1 || m_bYield;
+}
+
+// Measures the kernels of the rounds that have completed and schedules the next round. A device idle but for this is
+// busy for the kernel of the last round out of every interval between two rounds, so that interval is the kernel time
+// over the duty cycle, stretched while yielding. Rounds are sized to last ERADICATE2_PACE_ROUND on an idle device.
+void Dispatcher::paceUpdate(Device & d) {
+	while (!d.m_qPaceEvents.empty()) {
+		std::pair<size_t, std::vector<cl_event>> & p = d.m_qPaceEvents.front();
+		cl_int status = CL_COMPLETE;
+		clGetEventInfo(p.second.back(), CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, NULL);
+		if (status > CL_COMPLETE) {
+			break;
+		}
+
+		cl_ulong timeStart, timeEnd;
+		if (status == CL_COMPLETE && clGetEventProfilingInfo(p.second.front(), CL_PROFILING_COMMAND_START, sizeof(timeStart), &timeStart, NULL) == CL_SUCCESS && clGetEventProfilingInfo(p.second.back(), CL_PROFILING_COMMAND_END, sizeof(timeEnd), &timeEnd, NULL) == CL_SUCCESS && timeEnd > timeStart) {
+			d.m_paceRate = static_cast<double>(timeEnd - timeStart) / 1e9 / p.first;
+
+			// Rounds slower than the device can go mean something else is running on it
+			if (m_bYield && d.m_paceRateBest != 0) {
+				d.m_paceBackoff = d.m_paceRate > d.m_paceRateBest * ERADICATE2_PACE_SLOW ? std::min<unsigned int>(d.m_paceBackoff * 2, ERADICATE2_PACE_BACKOFF) : std::max(d.m_paceBackoff / 2, 1U);
+			}
+
+			d.m_paceRateBest = d.m_paceRateBest == 0 ? d.m_paceRate : std::min(d.m_paceRateBest, d.m_paceRate);
+		}
+
+		for (auto & event : p.second) {
+			clReleaseEvent(event);
+		}
+
+		d.m_qPaceEvents.pop_front();
+	}
+
+	if (d.m_paceRate == 0) {
+		return;
+	}
+
+	const std::chrono::duration<double> interval(d.m_paceRate * d.m_sizeRound / m_dutyCycle * d.m_paceBackoff);
+	d.m_timePace = d.m_timeEnqueue + std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval);
+
+	const size_t granularity = std::max<size_t>(d.m_worksizeLocal, 1);
+	const size_t groups = static_cast<size_t>(ERADICATE2_PACE_ROUND / d.m_paceRateBest) / granularity;
+	d.m_sizeRound = std::min(d.m_size, std::max<size_t>(groups, 1) * granularity);
+}
+
+// Sleeps until the next round is due, stop() cuts it short
+void Dispatcher::paceWait(Device & d) {
+	if (m_quit || std::chrono::steady_clock::now() >= d.m_timePace) {
+		return;
+	}
+
+	Trace::Scope scope(m_pTrace, "idle", d.m_index);
+	for (auto now = std::chrono::steady_clock::now(); !m_quit && now < d.m_timePace; now = std::chrono::steady_clock::now()) {
+		std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(d.m_timePace - now, std::chrono::milliseconds(10)));
+	}
+}
+
+void Dispatcher::paceClear(Device & d) {
+	for (auto & p : d.m_qPaceEvents) {
+		for (auto & event : p.second) {
+			clReleaseEvent(event);
+		}
+	}
+
+	d.m_qPaceEvents.clear();
 }
 
+// An error only takes this device out of the run, the others carry on with their own salts
 void Dispatcher::deviceDispatch(Device & d) {
-	// Check result
-	for (auto i = ERADICATE2_MAX_SCORE; i > m_clScoreMax; --i) {
-		result & r = d.m_memResult[i];
+	try {
+		deviceRound(d);
+	} catch (std::runtime_error & e) {
+		deviceFailed(d, e.what());
+	}
+}
+
+// Marks a device failed and schedules its recreation, false if it already was. The device must not be in the dispatch loop.
+bool Dispatcher::deviceFail(Device & d, const std::string & strProblem) {
+	if (d.m_bFailed.exchange(true)) {
+		return false;
+	}
 
-		if (r.found > 0 && i >= d.m_clScoreMax) {
-			d.m_clScoreMax = i;
-			CLMemory<cl_uchar>::setKernelArg(d.m_kernelIterate, 2, d.m_clScoreMax);
+	++d.m_failures;
+	const bool bRetry = d.m_failures < ERADICATE2_DEVICE_RETRIES;
+	d.m_bExcluded = d.m_bExcluded || !bRetry;
+	d.m_timeFinish = std::chrono::steady_clock::now();
+	d.m_timeRetry = d.m_timeFinish + std::chrono::seconds(ERADICATE2_DEVICE_BACKOFF << (d.m_failures - 1));
+	m_speed.remove(d.m_index);
 
-			std::lock_guard<std::mutex> lock(m_mutex);
-			if (i >= m_clScoreMax) {
-				m_clScoreMax = i;
+	if (m_failureCallback) {
+		m_failureCallback(d.m_index, strProblem, bRetry);
+	}
+
+	return true;
+}
+
+// Takes a failed device out of the dispatch loop
+void Dispatcher::deviceFailed(Device & d, const std::string & strProblem) {
+	if (deviceFail(d, strProblem)) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_countRunning == 0) {
+			m_cvFinished.notify_all();
+		}
+	}
+}
+
+void Dispatcher::deviceRound(Device & d) {
+	const long long timeRound = m_pTrace ? Trace::now() : 0;
+	if (m_pTrace) {
+		traceFlush(d);
+	}
+
+	// Check result of each mode
+	for (size_t k = 0; k < m_vScoreMax.size(); ++k) {
+		const cl_uchar scoreMaxDevice = static_cast<cl_uchar>(d.m_clScoreMax >> (8 * k));
+
+		for (auto i = ERADICATE2_MAX_SCORE; i > m_vScoreMax[k]; --i) {
+			result & r = d.m_memResult[k * (ERADICATE2_MAX_SCORE + 1) + i];
+
+			if (r.found > 0 && i >= scoreMaxDevice) {
+				d.m_clScoreMax = (d.m_clScoreMax & ~(static_cast<cl_ulong>(0xFF) << (8 * k))) | (static_cast<cl_ulong>(i) << (8 * k));
+				CLMemory<cl_ulong>::setKernelArg(d.m_kernelIterate, 3, d.m_clScoreMax);
+
+				const long long timeLock = m_pTrace ? Trace::now() : 0;
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_pTrace) {
+					m_pTrace->span("lock", d.m_index, Trace::Host, timeLock, Trace::now());
+				}
 
-				// TODO: Add quit condition
+				if (i >= m_vScoreMax[k]) {
+					m_vScoreMax[k] = i;
 
-				printResult(r, i, timeStart);
+					if (m_resultCallback) {
+						Trace::Scope scopeResult(m_pTrace, "result", d.m_index);
+						m_resultCallback(r, i, k, d.m_index);
+					}
+
+					// Any mode reaching the target ends the search
+					if (m_clScoreTarget != 0 && i >= m_clScoreTarget) {
+						m_quit = true;
+					}
+				}
+
+				break;
 			}
+		}
 
-			break;
+		// Scores beaten elsewhere, by other devices or through raiseScoreMax(), needn't be reported by this one
+		if (m_vScoreMax[k] > static_cast<cl_uchar>(d.m_clScoreMax >> (8 * k))) {
+			d.m_clScoreMax = (d.m_clScoreMax & ~(static_cast<cl_ulong>(0xFF) << (8 * k))) | (static_cast<cl_ulong>(m_vScoreMax[k]) << (8 * k));
+			CLMemory<cl_ulong>::setKernelArg(d.m_kernelIterate, 3, d.m_clScoreMax);
 		}
 	}
 
-	d.m_parent.m_speed.update(d.m_parent.m_size, d.m_index);
+	// The histogram read of the previous dispatch was queued before the last kernel so it covers one round less
+	if (m_bHistogram && d.m_round > 0) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		histogramUpdate(d, d.m_hashesEnqueued - d.m_sizeRound);
+	}
+
+	if (m_candidateCallback && d.m_round > 0) {
+		Trace::Scope scopeCandidates(m_pTrace, "candidates", d.m_index);
+		candidatesHandle(d);
+	}
+
+	if (d.m_parent.m_speed.update(d.m_sizeRound, d.m_index) && m_progressCallback) {
+		Trace::Scope scopeProgress(m_pTrace, "progress", d.m_index);
+		m_progressCallback(m_speed);
+	}
+
+	// Recorded before leaving the loop, wait() may return and the trace be written as soon as the last device left
+	if (m_pTrace) {
+		m_pTrace->span("round", d.m_index, Trace::Host, timeRound, Trace::now());
+	}
+
+	if (paced() && !m_bNoop) {
+		paceUpdate(d);
+		paceWait(d);
+	}
+
+	if (m_quit || d.m_bExcluded || (m_roundLimit != 0 && d.m_round >= m_roundLimit)) {
+		d.m_timeFinish = std::chrono::steady_clock::now();
 
-	if (m_quit) {
 		std::lock_guard<std::mutex> lock(m_mutex);
 		if (--m_countRunning == 0) {
-			clSetUserEventStatus(m_eventFinished, CL_COMPLETE);
+			m_cvFinished.notify_all();
 		}
 	} else {
 		cl_event event;
+		if (m_bHistogram) {
+			d.m_memHistogram.read(false);
+		}
+
+		// The count is cleared behind the reads, before the next round appends to the buffer
+		if (m_candidateCallback) {
+			d.m_memCandidateCount.read(false);
+			d.m_memCandidates.read(false);
+			d.m_memCandidateCount.fill(0);
+		}
 		d.m_memResult.read(false, &event);
-		
-		CLMemory<cl_uint>::setKernelArg(d.m_kernelIterate, 4, ++d.m_round); // Round information updated in deviceDispatch()
-		enqueueKernelDevice(d, d.m_kernelIterate, m_size);
-		clFlush(d.m_clQueue);
+		if (m_pTrace && clRetainEvent(event) == CL_SUCCESS) {
+			d.m_vTraceEvents.push_back(std::make_pair("read results", event));
+		}
+
+		try {
+			CLMemory<cl_uint>::setKernelArg(d.m_kernelIterate, 5, ++d.m_round); // Round information updated in deviceDispatch()
+			if (m_bNoop) {
+				enqueueKernelDevice(d, d.m_kernelNoop, std::max<size_t>(d.m_worksizeLocal, 1), "noop");
+			} else {
+				std::vector<cl_event> vEvents;
+				enqueueKernelDevice(d, d.m_kernelIterate, d.m_sizeRound, "kernel", paced() ? &vEvents : NULL);
+				d.m_hashesEnqueued += d.m_sizeRound;
+				d.m_timeEnqueue = std::chrono::steady_clock::now();
+				if (!vEvents.empty()) {
+					d.m_qPaceEvents.push_back(std::make_pair(d.m_sizeRound, vEvents));
+				}
+			}
+			clFlush(d.m_clQueue);
 
-		const auto res = clSetEventCallback(event, CL_COMPLETE, staticCallback, &d);
-		OpenCLException::throwIfError("failed to set custom callback", res);
+			if (m_dispatchModel == DispatchModel::Callback) {
+				const auto res = clSetEventCallback(event, CL_COMPLETE, staticCallback, &d);
+				OpenCLException::throwIfError("failed to set custom callback", res);
+			} else {
+				d.m_clEvent = event;
+			}
+		} catch (std::runtime_error &) {
+			clReleaseEvent(event);
+			throw;
+		}
 	}
 }
 
 void CL_CALLBACK Dispatcher::staticCallback(cl_event event, cl_int event_command_exec_status, void * user_data) {
-	if (event_command_exec_status != CL_COMPLETE) {
-		throw std::runtime_error("Dispatcher::onEvent - Got bad status" + lexical_cast::write(event_command_exec_status));
-	}
-
 	Device * const pDevice = static_cast<Device *>(user_data);
-	pDevice->m_parent.deviceDispatch(*pDevice);
 	clReleaseEvent(event);
+
+	// Throwing on a driver thread would end the process, a bad status only fails the device
+	if (event_command_exec_status != CL_COMPLETE) {
+		pDevice->m_parent.deviceFailed(*pDevice, "bad event status " + lexical_cast::write(event_command_exec_status));
+	} else {
+		pDevice->m_parent.deviceDispatch(*pDevice);
+	}
 }
@@ -6,6 +6,14 @@
 #include <string>
 #include <vector>
 #include <mutex>
+#include <map>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <condition_variable>
 
 #if defined(__APPLE__) || defined(__MACOSX)
 #include <OpenCL/cl.h>
@@ -16,10 +24,18 @@
 
 #include "CLMemory.hpp"
 #include "Speed.hpp"
+#include "Trace.hpp"
 #include "types.hpp"
 
 #define ERADICATE2_SPEEDSAMPLES 20
 #define ERADICATE2_MAX_SCORE 40
+#define ERADICATE2_MAX_MODES 8 // Best score of each mode is packed into a byte of a cl_ulong kernel argument
+#define ERADICATE2_MAX_CANDIDATES 16384 // Per device and round, further candidates are counted as dropped
+#define ERADICATE2_DEVICE_RETRIES 3 // OpenCL errors a device may have before it's excluded for good
+#define ERADICATE2_DEVICE_BACKOFF 10 // Seconds before a failed device is recreated, doubled with every failure
+#define ERADICATE2_PACE_ROUND 0.02 // Seconds a paced round lasts at most, how long other work may have to wait for a device
+#define ERADICATE2_PACE_SLOW 1.5 // A yielding device backs off while its rounds take this much longer per hash than its fastest
+#define ERADICATE2_PACE_BACKOFF 16 // Most a yielding device stretches the interval between its rounds by
 
 class Dispatcher {
 	private:
@@ -33,42 +49,148 @@ class Dispatcher {
 		};
 
 		struct Device {
-			static cl_command_queue createQueue(cl_context & clContext, cl_device_id & clDeviceId);
+			static cl_command_queue createQueue(cl_context & clContext, cl_device_id & clDeviceId, const bool bProfiling);
 			static cl_kernel createKernel(cl_program & clProgram, const std::string s);
 
-			Device(Dispatcher & parent, cl_context & clContext, cl_program & clProgram, cl_device_id clDeviceId, const size_t worksizeLocal, const size_t size, const size_t index);
+			Device(Dispatcher & parent, cl_context & clContext, cl_program & clProgram, cl_device_id clDeviceId, const size_t worksizeLocal, const size_t worksizeMax, const size_t size, const size_t index);
 			~Device();
 
 			Dispatcher & m_parent;
 			const size_t m_index;
 
+			cl_context m_clContext;
+			cl_program m_clProgram;
 			cl_device_id m_clDeviceId;
 			size_t m_worksizeLocal;
-			cl_uchar m_clScoreMax;
+			const size_t m_worksizeMax;
+			const size_t m_size;
+			cl_ulong m_clScoreMax;
 			cl_command_queue m_clQueue;
 
 			cl_kernel m_kernelIterate;
+			cl_kernel m_kernelNoop;
 
 			CLMemory<result> m_memResult;
 			CLMemory<mode> m_memMode;
+			CLMemory<job> m_memJob;
+			CLMemory<cl_uint> m_memHistogram;
+			CLMemory<cl_uint> m_memCandidateCount;
+			CLMemory<candidate> m_memCandidates;
+			std::unique_ptr<CLMemory<cl_ulong>> m_pMemInitCode; // Sized per job
 
 			cl_uint m_round;
+			std::atomic<bool> m_bExcluded; // Left out of runs, e.g. after reporting a wrong result
+			std::atomic<bool> m_bFailed; // Left the run after an OpenCL error, recreated by start() once m_timeRetry has passed
+			unsigned int m_failures;
+			std::chrono::time_point<std::chrono::steady_clock> m_timeRetry;
+			cl_event m_clEvent; // Completion of the pending round when not dispatching from event callbacks
+			std::chrono::time_point<std::chrono::steady_clock> m_timeFinish;
+
+			// Profiled commands not yet turned into trace spans, and the host minus device clock estimated from them
+			std::vector<std::pair<const char *, cl_event>> m_vTraceEvents;
+			long long m_traceOffset;
+
+			// Device counters wrap around so only the difference to the last read is accumulated
+			std::vector<cl_uint> m_vHistogramLast;
+			std::vector<cl_ulong> m_vHistogram;
+			cl_ulong m_histogramHashes;
+
+			// Size of the last round and the hashes of all rounds enqueued since start(). Paced rounds are sized from the
+			// profiled kernels of the rounds in flight, the fewest seconds per hash measured is what the device does when
+			// nothing else is running on it.
+			size_t m_sizeRound;
+			cl_ulong m_hashesEnqueued;
+			std::chrono::time_point<std::chrono::steady_clock> m_timeEnqueue;
+			std::chrono::time_point<std::chrono::steady_clock> m_timePace; // The next round isn't enqueued before this
+			std::deque<std::pair<size_t, std::vector<cl_event>>> m_qPaceEvents;
+			double m_paceRate;
+			double m_paceRateBest;
+			unsigned int m_paceBackoff;
 		};
 
 	public:
-		Dispatcher(cl_context & clContext, cl_program & clProgram, const size_t worksizeMax, const size_t size);
+		// Both callbacks are invoked from OpenCL driver threads. Results are delivered while holding the
+		// dispatcher lock so they arrive one at a time and in increasing score order.
+		typedef std::function<void(const result & r, const cl_uchar score, const size_t modeIndex, const size_t deviceIndex)> ResultCallback;
+		typedef std::function<void(const Speed & speed)> ProgressCallback;
+		// Invoked once per round and device with the candidates that passed the prefilter, not holding the dispatcher lock
+		typedef std::function<void(const candidate * pCandidates, const size_t count, const size_t dropped, const size_t deviceIndex)> CandidateCallback;
+		// Invoked when an OpenCL error takes a device out of the run, bRetry tells whether a later start() recreates it
+		typedef std::function<void(const size_t deviceIndex, const std::string & strProblem, const bool bRetry)> FailureCallback;
+
+		// Score counts of a device since start(), ERADICATE2_MAX_SCORE + 1 bins per mode
+		struct Histogram {
+			Histogram();
+
+			cl_ulong hashes; // Hashes covered by the counts, every mode counts each of them once
+			std::vector<cl_ulong> vCount;
+		};
+
+		// Where the host side of a round runs once its results have been read back:
+		//   Callback - OpenCL event callbacks, on whatever driver thread fires them
+		//   Thread   - a host thread per device blocking on the event
+		//   Poll     - a single host thread polling the events of all devices
+		enum class DispatchModel {
+			Callback, Thread, Poll
+		};
+
+		// With pTrace set the queues are created with profiling and every round is recorded in it. A dutyCycle below 1
+		// keeps every device busy only that share of the time, with bYield a device backs off while other work slows its
+		// rounds down. Either paces the rounds, which are then cut to ERADICATE2_PACE_ROUND and dispatched from a thread
+		// per device whatever dispatchModel says, sleeping on driver or polling threads would hold up other devices.
+		Dispatcher(const DispatchModel dispatchModel = DispatchModel::Callback, const bool bHistogram = false, FailureCallback failureCallback = nullptr, Trace * const pTrace = NULL, const double dutyCycle = 1, const bool bYield = false);
 		~Dispatcher();
 
-		void addDevice(cl_device_id clDeviceId, const size_t worksizeLocal, const size_t index);
-		void run(const mode & mode);
+		void addDevice(cl_context & clContext, cl_program & clProgram, cl_device_id clDeviceId, const size_t worksizeLocal, const size_t worksizeMax, const size_t size, const size_t index);
 
-	private:
-		void deviceDispatch(Device & d);
+		// vScoreMax holds the score each mode's results must beat. vInitCode holds the padded init code blocks hashed per
+		// candidate when job.initCodeBlocks is set. With
+		// job.candidateScore set every hash scoring at least that in modeCandidate is passed to candidateCallback. The
+		// devices hash with deviceIndexBase plus their index, e.g. to keep apart processes sharing a job.
+		void start(const std::vector<mode> & vModes, const job & job, const cl_uint deviceIndexBase, const std::vector<cl_ulong> & vInitCode, const std::vector<cl_uchar> & vScoreMax, const cl_uchar scoreTarget, ResultCallback resultCallback, ProgressCallback progressCallback, const mode & modeCandidate = mode(), CandidateCallback candidateCallback = nullptr);
+		void stop();
+		void wait();
+		bool running();
+		Histogram histogram(const size_t deviceIndex);
+		cl_uint rounds(); // Most rounds any device has enqueued since start(), a job started again past them hashes new salts
+
+		// Results of the mode must beat score from now on, e.g. the best score of other processes. Devices pick it up with
+		// their next dispatch.
+		void raiseScoreMax(const size_t modeIndex, const cl_uchar score);
 
-		void enqueueKernel(cl_command_queue & clQueue, cl_kernel & clKernel, size_t worksizeGlobal, const size_t worksizeLocal, cl_event * pEvent);
-		void enqueueKernelDevice(Device & d, cl_kernel & clKernel, size_t worksizeGlobal, cl_event * pEvent);
+		// Runs a single round of size hashes on one device and waits for it. Returns the result tables of the modes, entries
+		// with found set hold the first hash reaching their score. Used to check devices against the host.
+		std::vector<result> runOnce(const size_t deviceIndex, const std::vector<mode> & vModes, const job & job, const std::vector<cl_ulong> & vInitCode, const size_t size);
 
-		void printSpeed();
+		// Takes a device out of the running and any later run, it leaves the dispatch loop after its current round
+		void exclude(const size_t deviceIndex);
+
+		// Runs the given number of rounds on every device with a kernel that does nothing and returns the mean seconds per
+		// round of each device index, which is the host round trip of the dispatch model
+		std::map<size_t, double> benchmarkRoundTrip(const DispatchModel dispatchModel, const cl_uint rounds);
+
+	private:
+		Device & device(const size_t deviceIndex);
+		void deviceSetup(Device & d, const std::vector<mode> & vModes, const job & job, const cl_uint deviceIndexBase, const std::vector<cl_ulong> & vInitCode, const std::vector<cl_uchar> & vScoreMax, const mode & modeCandidate);
+		void launch();
+		void joinThreads();
+		void threadDevice(Device & d);
+		void threadPoll();
+		void deviceDispatch(Device & d);
+		void deviceRound(Device & d);
+		bool deviceFail(Device & d, const std::string & strProblem);
+		void deviceFailed(Device & d, const std::string & strProblem);
+		void deviceRecover();
+		void histogramUpdate(Device & d, const cl_ulong hashes);
+		void candidatesHandle(Device & d);
+		void traceFlush(Device & d);
+		bool paced() const;
+		void paceUpdate(Device & d);
+		void paceWait(Device & d);
+		void paceClear(Device & d);
+
+		void enqueueKernel(cl_command_queue & clQueue, cl_kernel & clKernel, size_t worksizeGlobal, const size_t worksizeLocal, const size_t worksizeMax, std::vector<cl_event> * pvEvents);
+		void enqueueKernelDevice(Device & d, cl_kernel & clKernel, size_t worksizeGlobal, const char * const szTrace, std::vector<cl_event> * const pvEvents);
 
 	private:
 		static void CL_CALLBACK staticCallback(cl_event event, cl_int event_command_exec_status, void * user_data);
@@ -76,22 +198,30 @@ class Dispatcher {
 		static std::string formatSpeed(double s);
 
 	private: /* Instance variables */
-		cl_context & m_clContext;
-		cl_program & m_clProgram;
-		const size_t m_worksizeMax;
-		const size_t m_size;
-		cl_uchar m_clScoreMax;
+		DispatchModel m_dispatchModel;
+		Trace * const m_pTrace;
+		const bool m_bHistogram; // Kernel built with ERADICATE2_HISTOGRAM
+		const double m_dutyCycle;
+		const bool m_bYield;
+		bool m_bNoop; // Dispatch eradicate2_noop instead of eradicate2_iterate
+		cl_uint m_roundLimit; // Devices leave the dispatch loop after this many rounds, 0 for no limit
+		std::vector<cl_uchar> m_vScoreMax;
+		cl_uchar m_clScoreTarget;
 		std::vector<Device *> m_vDevices;
-
-		cl_event m_eventFinished;
+		std::vector<std::thread> m_vThreads;
 
 		// Run information
 		std::mutex m_mutex;
-		std::chrono::time_point<std::chrono::steady_clock> timeStart;
+		std::condition_variable m_cvFinished;
 		Speed m_speed;
 		unsigned int m_countPrint;
 		unsigned int m_countRunning;
-		bool m_quit;
+		std::atomic<bool> m_quit;
+
+		ResultCallback m_resultCallback;
+		ProgressCallback m_progressCallback;
+		CandidateCallback m_candidateCallback;
+		FailureCallback m_failureCallback;
 };
 
 #endif /* HPP_DISPATCHER */
@@ -0,0 +1,103 @@
+#include "HostScorer.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include <regex>
+#include <dlfcn.h>
+
+#include "hexadecimal.hpp"
+
+// Score is the number of characters covered by words from a list, e.g. "c0ffee" or "deadbeef", scanning the address
+// from the left and taking the longest word starting at each position
+class WordsScorer : public HostScorer {
+	public:
+		WordsScorer(const std::string & strFilename) {
+			std::ifstream ifs(strFilename);
+			if (!ifs.is_open()) {
+				throw std::runtime_error("failed to open word list \"" + strFilename + "\"");
+			}
+
+			std::string strWord;
+			while (ifs >> strWord) {
+				std::transform(strWord.begin(), strWord.end(), strWord.begin(), ::tolower);
+				if (strWord.find_first_not_of("0123456789abcdef") != std::string::npos) {
+					throw std::runtime_error("word \"" + strWord + "\" is not hexadecimal");
+				}
+
+				m_vWords.push_back(strWord);
+			}
+
+			// Longest first so the first match at a position is the longest
+			std::sort(m_vWords.begin(), m_vWords.end(), [](const std::string & a, const std::string & b) { return a.size() > b.size(); });
+		}
+
+		unsigned int score(const std::string & strAddress, const std::string & strSalt) const {
+			const std::string strHex = toHex(reinterpret_cast<const uint8_t *>(strAddress.data()), strAddress.size());
+			unsigned int score = 0;
+
+			for (size_t i = 0; i < strHex.size(); ) {
+				auto it = std::find_if(m_vWords.begin(), m_vWords.end(), [&](const std::string & w) { return strHex.compare(i, w.size(), w) == 0; });
+				if (it != m_vWords.end() && !it->empty()) {
+					score += it->size();
+					i += it->size();
+				} else {
+					++i;
+				}
+			}
+
+			return score;
+		}
+
+	private:
+		std::vector<std::string> m_vWords;
+};
+
+// Score is the length of the first match of a regular expression in the lower case hexadecimal address
+class RegexScorer : public HostScorer {
+	public:
+		RegexScorer(const std::string & strPattern) :
+			m_regex(strPattern, std::regex::optimize)
+		{
+		}
+
+		unsigned int score(const std::string & strAddress, const std::string & strSalt) const {
+			const std::string strHex = toHex(reinterpret_cast<const uint8_t *>(strAddress.data()), strAddress.size());
+			std::smatch match;
+			return std::regex_search(strHex, match, m_regex) ? match.length(0) : 0;
+		}
+
+	private:
+		const std::regex m_regex;
+};
+
+std::shared_ptr<HostScorer> HostScorer::create(const std::string & strName, const std::string & strArg) {
+	if (strName == "words") {
+		return std::make_shared<WordsScorer>(strArg);
+	} else if (strName == "regex") {
+		return std::make_shared<RegexScorer>(strArg);
+	} else if (strName.find('/') == std::string::npos) {
+		throw std::runtime_error("unknown scorer \"" + strName + "\"");
+	}
+
+	void * const pHandle = dlopen(strName.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (pHandle == NULL) {
+		throw std::runtime_error("failed to load scorer \"" + strName + "\" - " + dlerror());
+	}
+
+	typedef HostScorer * (*CreateFunction)(const char *);
+	const CreateFunction pCreate = reinterpret_cast<CreateFunction>(dlsym(pHandle, "eradicate2_scorer_create"));
+	if (pCreate == NULL) {
+		dlclose(pHandle);
+		throw std::runtime_error("scorer \"" + strName + "\" doesn't export eradicate2_scorer_create");
+	}
+
+	HostScorer * const pScorer = pCreate(strArg.c_str());
+	if (pScorer == NULL) {
+		dlclose(pHandle);
+		throw std::runtime_error("scorer \"" + strName + "\" failed to create a scorer for \"" + strArg + "\"");
+	}
+
+	return std::shared_ptr<HostScorer>(pScorer, [pHandle](HostScorer * p) { delete p; dlclose(pHandle); });
+}
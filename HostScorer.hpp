@@ -0,0 +1,27 @@
+#ifndef HPP_HOSTSCORER
+#define HPP_HOSTSCORER
+
+#include <memory>
+#include <string>
+
+/* Scores addresses on the host, for rules too complex or too volatile to write in OpenCL C. Only hashes that pass
+ * the prefilter on the devices reach a scorer and they are scored from several threads at once, so score() must be
+ * thread safe. Besides the built-in scorers a shared library can provide one by exporting
+ *
+ *   extern "C" HostScorer * eradicate2_scorer_create(const char * szArg);
+ *
+ * which returns NULL if the argument is bad. The scorer is deleted before the library is unloaded.
+ */
+class HostScorer {
+	public:
+		virtual ~HostScorer() {}
+
+		// strAddress is the 20 byte address and strSalt the 32 byte salt deploying to it. Higher is better, 0 is no match.
+		virtual unsigned int score(const std::string & strAddress, const std::string & strSalt) const = 0;
+
+		// Built-in scorer by name, "words" with a word list file or "regex" with a pattern, or a shared library when the
+		// name contains a '/', e.g. "./libscorer.so"
+		static std::shared_ptr<HostScorer> create(const std::string & strName, const std::string & strArg);
+};
+
+#endif /* HPP_HOSTSCORER */
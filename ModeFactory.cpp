@@ -1,7 +1,46 @@
 #include "ModeFactory.hpp"
 
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
 #include "hexadecimal.hpp"
 
+// Score is the length of a run of trials each succeeding with probability p, at most count long
+static std::vector<double> distributionRun(const double p, const size_t count) {
+	std::vector<double> v(count + 1, 0.0);
+	for (size_t i = 0; i < count; ++i) {
+		v[i] = std::pow(p, static_cast<double>(i)) * (1.0 - p);
+	}
+
+	v[count] = std::pow(p, static_cast<double>(count));
+	return v;
+}
+
+// Score is the number of successes of independent trials with the given probabilities
+static std::vector<double> distributionCount(const std::vector<double> & vP) {
+	std::vector<double> v(vP.size() + 1, 0.0);
+	v[0] = 1.0;
+
+	for (size_t i = 0; i < vP.size(); ++i) {
+		for (size_t j = i + 1; j > 0; --j) {
+			v[j] = v[j] * (1.0 - vP[i]) + v[j - 1] * vP[i];
+		}
+
+		v[0] *= 1.0 - vP[i];
+	}
+
+	return v;
+}
+
+static size_t popcount(cl_uchar b) {
+	size_t r = 0;
+	for (; b; b &= b - 1) {
+		++r;
+	}
+
+	return r;
+}
+
 mode ModeFactory::benchmark() {
 	mode r;
 	r.function = ModeFunction::Benchmark;
@@ -88,3 +127,207 @@ mode ModeFactory::doubles() {
 	r.function = ModeFunction::Doubles;
 	return r;
 }
+
+mode ModeFactory::gas(const bool bSalt) {
+	mode r;
+	r.function = ModeFunction::Gas;
+	r.data1[0] = bSalt ? 1 : 0;
+	return r;
+}
+
+mode ModeFactory::parse(const std::string & strName, const std::string & strArg, const cl_uchar min, const cl_uchar max) {
+	if (strName == "benchmark") {
+		return benchmark();
+	} else if (strName == "zero-bytes") {
+		return zerobytes();
+	} else if (strName == "zeros") {
+		return zeros();
+	} else if (strName == "letters") {
+		return letters();
+	} else if (strName == "numbers") {
+		return numbers();
+	} else if (strName == "leading" && !strArg.empty()) {
+		return leading(strArg.front());
+	} else if (strName == "matching" && !strArg.empty()) {
+		return matching(strArg);
+	} else if (strName == "leading-range") {
+		return leadingRange(min, max);
+	} else if (strName == "range") {
+		return range(min, max);
+	} else if (strName == "mirror") {
+		return mirror();
+	} else if (strName == "leading-doubles") {
+		return doubles();
+	} else if (strName == "gas") {
+		return gas(strArg == "salt");
+	}
+
+	throw std::runtime_error("unknown mode \"" + strName + "\"");
+}
+
+std::string ModeFactory::key(const mode & m) {
+	// Only the mode data the scorer reads, the rest is left uninitialized
+	size_t sizeData = 0;
+	switch (m.function) {
+	case ModeFunction::Matching:
+		sizeData = sizeof(m.data1);
+		break;
+
+	case ModeFunction::Leading:
+	case ModeFunction::Range:
+	case ModeFunction::LeadingRange:
+	case ModeFunction::Gas:
+		sizeData = 1;
+		break;
+
+	default:
+		break;
+	}
+
+	std::string r(1, static_cast<char>(m.function));
+	r.append(reinterpret_cast<const char *>(m.data1), sizeData);
+	r.append(reinterpret_cast<const char *>(m.data2), sizeData);
+	return r;
+}
+
+unsigned int ModeFactory::score(const mode & m, const std::string & strAddress, const std::string & strSalt) {
+	const cl_uchar * const pAddress = reinterpret_cast<const cl_uchar *>(strAddress.data());
+	int score = 0;
+
+	// Nibble i of the address, high nibble first
+	auto nibble = [pAddress](const int i) { return (i % 2) ? pAddress[i / 2] & 0x0F : pAddress[i / 2] >> 4; };
+	auto inRange = [&m](const int x) { return x >= m.data1[0] && x <= m.data2[0]; };
+
+	switch (m.function) {
+	case ModeFunction::Benchmark:
+		break;
+
+	case ModeFunction::ZeroBytes:
+		score = static_cast<int>(std::count(pAddress, pAddress + 20, 0));
+		break;
+
+	case ModeFunction::Matching:
+		for (int i = 0; i < 20; ++i) {
+			score += m.data1[i] > 0 && (pAddress[i] & m.data1[i]) == m.data2[i];
+		}
+		break;
+
+	case ModeFunction::Leading:
+		while (score < 40 && nibble(score) == m.data1[0]) {
+			++score;
+		}
+		break;
+
+	case ModeFunction::Range:
+		for (int i = 0; i < 40; ++i) {
+			score += inRange(nibble(i));
+		}
+		break;
+
+	case ModeFunction::Mirror:
+		while (score < 20 && nibble(19 - score) == nibble(20 + score)) {
+			++score;
+		}
+		break;
+
+	case ModeFunction::Doubles:
+		while (score < 20 && nibble(2 * score) == nibble(2 * score + 1)) {
+			++score;
+		}
+		break;
+
+	case ModeFunction::LeadingRange:
+		while (score < 40 && inRange(nibble(score))) {
+			++score;
+		}
+		break;
+
+	case ModeFunction::Gas:
+		score = static_cast<int>(gasSaved(strAddress, m.data1[0] ? strSalt : std::string()) / ERADICATE2_GAS_PER_SCORE);
+		break;
+	}
+
+	return static_cast<unsigned int>(score);
+}
+
+unsigned int ModeFactory::gasSaved(const std::string & strAddress, const std::string & strSalt) {
+	const cl_uchar * const pAddress = reinterpret_cast<const cl_uchar *>(strAddress.data());
+	const size_t zeroBytes = std::count(pAddress, pAddress + 20, 0) + std::count(strSalt.begin(), strSalt.end(), '\0');
+	const size_t leading = std::find_if(pAddress, pAddress + 20, [](const cl_uchar b) { return b != 0; }) - pAddress;
+
+	return static_cast<unsigned int>(zeroBytes * ERADICATE2_GAS_ZERO_BYTE + leading * ERADICATE2_GAS_LEADING_BYTE);
+}
+
+std::vector<double> ModeFactory::distribution(const mode & m, const size_t scoreMax) {
+	const double pRange = m.data2[0] >= m.data1[0] ? std::min(m.data2[0] - m.data1[0] + 1, 16) / 16.0 : 0.0;
+	std::vector<double> v;
+
+	switch (m.function) {
+	case ModeFunction::Benchmark:
+		v.assign(1, 1.0);
+		break;
+
+	case ModeFunction::ZeroBytes:
+		v = distributionCount(std::vector<double>(20, 1.0 / 256));
+		break;
+
+	case ModeFunction::Matching:
+	{
+		std::vector<double> vP;
+		for (size_t i = 0; i < 20; ++i) {
+			if (m.data1[i] > 0) {
+				vP.push_back(std::pow(0.5, static_cast<double>(popcount(m.data1[i]))));
+			}
+		}
+
+		v = distributionCount(vP);
+		break;
+	}
+
+	case ModeFunction::Leading:
+		v = distributionRun(1.0 / 16, 40);
+		break;
+
+	case ModeFunction::Range:
+		v = distributionCount(std::vector<double>(40, pRange));
+		break;
+
+	case ModeFunction::Mirror:
+	case ModeFunction::Doubles:
+		v = distributionRun(1.0 / 16, 20);
+		break;
+
+	case ModeFunction::LeadingRange:
+		v = distributionRun(pRange, 40);
+		break;
+
+	case ModeFunction::Gas:
+		if (m.data1[0] == 0) {
+			// With l leading zero bytes the byte after them is non-zero and the remaining 19 - l are zero independently
+			auto scoreGas = [](const size_t zeroBytes, const size_t leading) { return (zeroBytes * ERADICATE2_GAS_ZERO_BYTE + leading * ERADICATE2_GAS_LEADING_BYTE) / ERADICATE2_GAS_PER_SCORE; };
+			const std::vector<double> vLeading = distributionRun(1.0 / 256, 20);
+			v.assign(scoreGas(20, 20) + 1, 0.0);
+			v[scoreGas(20, 20)] = vLeading[20];
+
+			for (size_t l = 0; l < 20; ++l) {
+				const std::vector<double> vRest = distributionCount(std::vector<double>(19 - l, 1.0 / 256));
+				for (size_t j = 0; j < vRest.size(); ++j) {
+					v[scoreGas(l + j, l)] += vLeading[l] * vRest[j];
+				}
+			}
+		}
+		break;
+	}
+
+	if (v.size() > scoreMax + 1) {
+		for (size_t i = scoreMax + 1; i < v.size(); ++i) {
+			v[scoreMax] += v[i];
+		}
+
+		v.resize(scoreMax + 1);
+	} else if (!v.empty()) {
+		v.resize(scoreMax + 1, 0.0);
+	}
+
+	return v;
+}
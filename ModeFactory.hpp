@@ -2,8 +2,15 @@
 #define HPP_MODEFACTORY
 
 #include <string>
+#include <vector>
 #include "types.hpp"
 
+// Gas mode: calldata gas saved per zero byte, code deposit gas saved per leading zero byte as the PUSH of the address gets
+// one byte shorter, and the gas a score point stands for so the highest score is still out of reach.
+#define ERADICATE2_GAS_ZERO_BYTE 12
+#define ERADICATE2_GAS_LEADING_BYTE 200
+#define ERADICATE2_GAS_PER_SCORE 32
+
 class ModeFactory {
 	private:
 		ModeFactory();
@@ -23,6 +30,24 @@ class ModeFactory {
 		static mode letters();
 		static mode numbers();
 		static mode doubles();
+		static mode gas(const bool bSalt);
+
+		// Mode by command line name, e.g. "zeros" or "leading" with strArg "0"
+		static mode parse(const std::string & strName, const std::string & strArg, const cl_uchar min, const cl_uchar max);
+
+		// The function and the parameters its scorer reads, identifying modes that score alike
+		static std::string key(const mode & m);
+
+		// Score of an address on the host, the same as on the devices before they cap it at ERADICATE2_MAX_SCORE. Gas with
+		// the salt counts every zero byte of strSalt.
+		static unsigned int score(const mode & m, const std::string & strAddress, const std::string & strSalt);
+
+		// Gas saved by an address and salt compared to ones without zero bytes, an empty salt saves nothing
+		static unsigned int gasSaved(const std::string & strAddress, const std::string & strSalt);
+
+		// Probability of each score 0..scoreMax for a uniformly random address, the last entry includes all higher scores.
+		// Empty when the mode has no closed form, e.g. gas with the salt counted.
+		static std::vector<double> distribution(const mode & m, const size_t scoreMax);
 };
 
 #endif /* HPP_MODEFACTORY */
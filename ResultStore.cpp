@@ -0,0 +1,179 @@
+#include "ResultStore.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "ModeFactory.hpp"
+
+// Results kept per key
+#define ERADICATE2_STORE_TOP 16
+
+static const char g_szStoreMagic[16] = { 'E', 'R', 'A', 'D', 'I', 'C', 'A', 'T', 'E', '2', 'S', 'T', 'O', 'R', 'E', '1' };
+
+#pragma pack(push, 1)
+typedef struct {
+	cl_uchar key[32];
+	cl_uchar salt[32];
+	cl_uchar address[20];
+	cl_uchar score;
+	cl_uchar reserved[3];
+	cl_ulong time;
+} StoreRecord;
+#pragma pack(pop)
+
+ResultStore::ResultStore(const std::string & strPath) :
+	m_strPath(strPath),
+	m_fd(-1),
+	m_bWriteFailed(false)
+{
+#ifdef _WIN32
+	throw std::runtime_error("results store requires POSIX file mapping");
+#else
+	m_fd = open(strPath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+	struct stat st;
+	if (m_fd == -1 || fstat(m_fd, &st) != 0) {
+		if (m_fd != -1) {
+			close(m_fd);
+		}
+
+		throw std::runtime_error("failed to open results store \"" + strPath + "\"");
+	}
+
+	const size_t size = static_cast<size_t>(st.st_size);
+	if (size == 0) {
+		if (write(m_fd, g_szStoreMagic, sizeof(g_szStoreMagic)) != sizeof(g_szStoreMagic)) {
+			close(m_fd);
+			throw std::runtime_error("failed to write results store \"" + strPath + "\"");
+		}
+
+		return;
+	}
+
+	void * const pMap = size < sizeof(g_szStoreMagic) ? MAP_FAILED : mmap(NULL, size, PROT_READ, MAP_SHARED, m_fd, 0);
+	if (pMap == MAP_FAILED || std::memcmp(pMap, g_szStoreMagic, sizeof(g_szStoreMagic)) != 0) {
+		if (pMap != MAP_FAILED) {
+			munmap(pMap, size);
+		}
+
+		close(m_fd);
+		throw std::runtime_error("\"" + strPath + "\" is not a results store");
+	}
+
+	const StoreRecord * const pRecords = reinterpret_cast<const StoreRecord *>(static_cast<const char *>(pMap) + sizeof(g_szStoreMagic));
+	const size_t count = (size - sizeof(g_szStoreMagic)) / sizeof(StoreRecord);
+
+	for (size_t i = 0; i < count; ++i) {
+		const StoreRecord & rec = pRecords[i];
+
+		Entry e;
+		e.strSalt.assign(reinterpret_cast<const char *>(rec.salt), sizeof(rec.salt));
+		e.strAddress.assign(reinterpret_cast<const char *>(rec.address), sizeof(rec.address));
+		e.score = rec.score;
+		e.time = rec.time;
+		insert(std::string(reinterpret_cast<const char *>(rec.key), sizeof(rec.key)), e);
+	}
+
+	munmap(pMap, size);
+
+	// A record cut short by a crash would misalign everything appended after it
+	if ((size - sizeof(g_szStoreMagic)) % sizeof(StoreRecord) != 0 && ftruncate(m_fd, sizeof(g_szStoreMagic) + count * sizeof(StoreRecord)) != 0) {
+		close(m_fd);
+		throw std::runtime_error("failed to truncate results store \"" + strPath + "\"");
+	}
+#endif
+}
+
+ResultStore::~ResultStore() {
+#ifndef _WIN32
+	close(m_fd);
+#endif
+}
+
+std::string ResultStore::key(const SearchEngine::Job & j, const mode & m) {
+	if (j.initCodeVariableSize != 0) {
+		return "";
+	}
+
+	std::string strPreimage = j.strAddressBinary + j.strInitCodeDigest;
+	strPreimage += static_cast<char>(j.bCreate3);
+	strPreimage += ModeFactory::key(m);
+	strPreimage += j.strSafeInitializerDigest;
+	strPreimage += j.strConstraintMask + j.strConstraintValue;
+	return SearchEngine::keccakDigest(strPreimage);
+}
+
+cl_uchar ResultStore::best(const std::string & strKey) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_mTop.find(strKey);
+	return it == m_mTop.end() || it->second.empty() ? 0 : it->second.front().score;
+}
+
+std::vector<ResultStore::Entry> ResultStore::top(const std::string & strKey) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_mTop.find(strKey);
+	return it == m_mTop.end() ? std::vector<Entry>() : it->second;
+}
+
+bool ResultStore::add(const std::string & strKey, const result & r, const cl_uchar score) {
+	if (strKey.empty()) {
+		return false;
+	}
+
+	Entry e;
+	e.strSalt.assign(reinterpret_cast<const char *>(r.salt), sizeof(r.salt));
+	e.strAddress.assign(reinterpret_cast<const char *>(r.hash), sizeof(r.hash));
+	e.score = score;
+	e.time = static_cast<cl_ulong>(std::time(NULL));
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!insert(strKey, e)) {
+		return false;
+	}
+
+#ifndef _WIN32
+	StoreRecord rec = StoreRecord();
+	std::copy(strKey.begin(), strKey.end(), rec.key);
+	std::copy(r.salt, r.salt + sizeof(r.salt), rec.salt);
+	std::copy(r.hash, r.hash + sizeof(r.hash), rec.address);
+	rec.score = score;
+	rec.time = e.time;
+
+	// Runs on the result callback, a full disk must not end the search. The entry stays in the top for this run.
+	if (write(m_fd, &rec, sizeof(rec)) != sizeof(rec) && !m_bWriteFailed) {
+		m_bWriteFailed = true;
+		std::cout << "\33[2K\r  warning: failed to write results store \"" << m_strPath << "\", results are no longer stored" << std::endl;
+	}
+#endif
+
+	return true;
+}
+
+// Must be called with m_mutex held unless still in the constructor
+bool ResultStore::insert(const std::string & strKey, const Entry & e) {
+	std::vector<Entry> & v = m_mTop[strKey];
+	if (std::any_of(v.begin(), v.end(), [&e](const Entry & o) { return o.strSalt == e.strSalt; })) {
+		return false;
+	}
+
+	auto it = std::upper_bound(v.begin(), v.end(), e, [](const Entry & a, const Entry & b) { return a.score > b.score; });
+	if (it - v.begin() >= ERADICATE2_STORE_TOP) {
+		return false;
+	}
+
+	v.insert(it, e);
+	if (v.size() > ERADICATE2_STORE_TOP) {
+		v.pop_back();
+	}
+
+	return true;
+}
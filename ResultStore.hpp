@@ -0,0 +1,51 @@
+#ifndef HPP_RESULTSTORE
+#define HPP_RESULTSTORE
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <map>
+
+#include "SearchEngine.hpp"
+#include "types.hpp"
+
+/* Results kept across runs in an append-only file of fixed size records. A record is keyed by the keccak256 of what
+ * makes results comparable: deployer, init code digest, CREATE3 and the mode with its parameters. The file is memory
+ * mapped and indexed once when opened, afterwards only records entering the best ERADICATE2_STORE_TOP of their key are
+ * appended. Several processes may append to the same file, records are written whole with O_APPEND.
+ */
+class ResultStore {
+	public:
+		struct Entry {
+			std::string strSalt; // 32 bytes
+			std::string strAddress; // 20 bytes
+			cl_uchar score;
+			cl_ulong time; // Seconds since the epoch
+		};
+
+	public:
+		ResultStore(const std::string & strPath);
+		~ResultStore();
+
+		// Empty key for jobs whose results can't be reproduced from the salt alone, e.g. varied init code
+		static std::string key(const SearchEngine::Job & j, const mode & m);
+
+		cl_uchar best(const std::string & strKey);
+		std::vector<Entry> top(const std::string & strKey); // Best first
+		bool add(const std::string & strKey, const result & r, const cl_uchar score); // True if it made the top, write errors are only reported
+
+	private:
+		ResultStore(ResultStore & o);
+		ResultStore & operator=(const ResultStore & o);
+
+		bool insert(const std::string & strKey, const Entry & e);
+
+	private:
+		const std::string m_strPath;
+		int m_fd;
+		bool m_bWriteFailed; // Reported once, later writes are attempted silently
+		std::mutex m_mutex;
+		std::map<std::string, std::vector<Entry>> m_mTop;
+};
+
+#endif /* HPP_RESULTSTORE */
@@ -0,0 +1,108 @@
+#include "ResultVerifier.hpp"
+
+#include <algorithm>
+
+#include "ModeFactory.hpp"
+#include "hexadecimal.hpp"
+#include "lexical_cast.hpp"
+
+ResultVerifier::ResultVerifier(const SearchEngine::Job & j, const job & jobDevice, ResultCallback resultCallback, FailureCallback failureCallback) :
+	m_job(j),
+	m_jobDevice(jobDevice),
+	m_resultCallback(resultCallback),
+	m_failureCallback(failureCallback),
+	m_bFinish(false),
+	m_thread(&ResultVerifier::worker, this)
+{
+
+}
+
+ResultVerifier::~ResultVerifier() {
+	finish();
+}
+
+void ResultVerifier::push(const result & r, const cl_uchar score, const size_t modeIndex, const size_t deviceIndex) {
+	Entry e;
+	e.r = r;
+	e.score = score;
+	e.modeIndex = modeIndex;
+	e.deviceIndex = deviceIndex;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_queue.push_back(e);
+	m_cvQueue.notify_all();
+}
+
+void ResultVerifier::finish() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bFinish = true;
+		m_cvQueue.notify_all();
+	}
+
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+std::string ResultVerifier::verify(const SearchEngine::Job & j, const job & jobDevice, const result & r, const cl_uchar score, const size_t modeIndex) {
+	candidate c;
+	c.deviceIndex = r.deviceIndex;
+	c.id = r.id;
+	c.round = r.round;
+
+	const std::string strSalt = SearchEngine::candidateSalt(jobDevice, c);
+	const std::string strAddress = SearchEngine::candidateAddress(j, jobDevice, c);
+
+	if (strSalt.compare(0, 32, reinterpret_cast<const char *>(r.salt), 32) != 0) {
+		return "salt 0x" + toHex(r.salt, 32) + " should be 0x" + toHex(reinterpret_cast<const uint8_t *>(strSalt.data()), 32);
+	}
+
+	if (strAddress.compare(0, 20, reinterpret_cast<const char *>(r.hash), 20) != 0) {
+		return "address 0x" + toHex(r.hash, 20) + " should be 0x" + toHex(reinterpret_cast<const uint8_t *>(strAddress.data()), 20);
+	}
+
+	if (!SearchEngine::constraintPass(j, strAddress)) {
+		return "address 0x" + toHex(reinterpret_cast<const uint8_t *>(strAddress.data()), 20) + " fails the constraint";
+	}
+
+	const unsigned int scoreHost = std::min<unsigned int>(ModeFactory::score(j.vModes[modeIndex], strAddress, strSalt), ERADICATE2_MAX_SCORE);
+	if (scoreHost != score) {
+		return "score " + lexical_cast::write(static_cast<unsigned int>(score)) + " should be " + lexical_cast::write(scoreHost);
+	}
+
+	return "";
+}
+
+void ResultVerifier::worker() {
+	for (;;) {
+		Entry e;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cvQueue.wait(lock, [&] { return !m_queue.empty() || m_bFinish; });
+
+			if (m_queue.empty()) {
+				return;
+			}
+
+			e = m_queue.front();
+			m_queue.pop_front();
+
+			if (m_sFailed.count(e.deviceIndex)) {
+				continue;
+			}
+		}
+
+		const std::string strProblem = verify(m_job, m_jobDevice, e.r, e.score, e.modeIndex);
+		if (strProblem.empty()) {
+			m_resultCallback(e.r, e.score, e.modeIndex, e.deviceIndex);
+		} else {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_sFailed.insert(e.deviceIndex);
+			}
+
+			m_failureCallback(e.deviceIndex, strProblem);
+		}
+	}
+}
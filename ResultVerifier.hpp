@@ -0,0 +1,63 @@
+#ifndef HPP_RESULTVERIFIER
+#define HPP_RESULTVERIFIER
+
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <set>
+
+#include "SearchEngine.hpp"
+#include "types.hpp"
+
+/* Recomputes every result reported by the devices with sha3.cpp before passing it on. The salt must be the one the
+ * device's counters give, the address must be the one the salt deploys to and the score must be the one the host gives
+ * the address. Verification runs on a thread of its own so the dispatch loop never waits for it and results are passed
+ * on in the order they arrived. A device reporting a wrong result is passed to the failure callback and its later
+ * results are dropped.
+ */
+class ResultVerifier {
+	public:
+		typedef SearchEngine::ResultCallback ResultCallback;
+		typedef std::function<void(const size_t deviceIndex, const std::string & strProblem)> FailureCallback;
+
+	public:
+		ResultVerifier(const SearchEngine::Job & j, const job & jobDevice, ResultCallback resultCallback, FailureCallback failureCallback);
+		~ResultVerifier();
+
+		void push(const result & r, const cl_uchar score, const size_t modeIndex, const size_t deviceIndex);
+		void finish(); // Verifies everything queued and stops the thread
+
+		// Empty if the result is right, otherwise what's wrong with it
+		static std::string verify(const SearchEngine::Job & j, const job & jobDevice, const result & r, const cl_uchar score, const size_t modeIndex);
+
+	private:
+		ResultVerifier(ResultVerifier & o);
+		ResultVerifier & operator=(const ResultVerifier & o);
+
+		void worker();
+
+	private:
+		struct Entry {
+			result r;
+			cl_uchar score;
+			size_t modeIndex;
+			size_t deviceIndex;
+		};
+
+		const SearchEngine::Job m_job;
+		const job m_jobDevice;
+		const ResultCallback m_resultCallback;
+		const FailureCallback m_failureCallback;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cvQueue;
+		std::deque<Entry> m_queue;
+		bool m_bFinish;
+		std::set<size_t> m_sFailed;
+		std::thread m_thread;
+};
+
+#endif /* HPP_RESULTVERIFIER */
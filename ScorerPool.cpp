@@ -0,0 +1,114 @@
+#include "ScorerPool.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// Candidates queued per scoring thread before further ones are dropped
+#define ERADICATE2_SCORER_QUEUE 65536
+
+ScorerPool::Stats::Stats() :
+	scored(0),
+	dropped(0),
+	backlog(0)
+{
+
+}
+
+ScorerPool::ScorerPool(const std::vector<std::shared_ptr<HostScorer>> & vScorers, const SearchEngine::Job & j, const job & jobDevice, const size_t threads, ResultCallback resultCallback) :
+	m_vScorers(vScorers),
+	m_job(j),
+	m_jobDevice(jobDevice),
+	m_resultCallback(resultCallback),
+	m_bFinish(false),
+	m_vScoreBest(vScorers.size(), j.scoreMax)
+{
+	const size_t count = threads == 0 ? std::max(std::thread::hardware_concurrency(), 1U) : threads;
+	for (size_t i = 0; i < count; ++i) {
+		m_vThreads.push_back(std::thread(&ScorerPool::worker, this));
+	}
+}
+
+ScorerPool::~ScorerPool() {
+	finish();
+}
+
+void ScorerPool::push(const candidate * const pCandidates, const size_t count, const size_t dropped) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const size_t countQueued = std::min(count, ERADICATE2_SCORER_QUEUE * m_vThreads.size() - std::min(m_queue.size(), ERADICATE2_SCORER_QUEUE * m_vThreads.size()));
+
+	m_queue.insert(m_queue.end(), pCandidates, pCandidates + countQueued);
+	m_stats.dropped += dropped + count - countQueued;
+	m_cvQueue.notify_all();
+}
+
+void ScorerPool::finish() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bFinish = true;
+		m_cvQueue.notify_all();
+	}
+
+	for (auto & t : m_vThreads) {
+		if (t.joinable()) {
+			t.join();
+		}
+	}
+}
+
+ScorerPool::Stats ScorerPool::stats() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Stats r = m_stats;
+	r.backlog = m_queue.size();
+	return r;
+}
+
+void ScorerPool::worker() {
+	std::vector<candidate> vBatch;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_stats.scored += vBatch.size();
+			m_cvQueue.wait(lock, [&] { return !m_queue.empty() || m_bFinish; });
+
+			if (m_queue.empty()) {
+				return;
+			}
+
+			const size_t count = std::min<size_t>(m_queue.size(), 256);
+			vBatch.assign(m_queue.begin(), m_queue.begin() + count);
+			m_queue.erase(m_queue.begin(), m_queue.begin() + count);
+		}
+
+		for (auto & c : vBatch) {
+			score(c);
+		}
+	}
+}
+
+void ScorerPool::score(const candidate & c) {
+	const std::string strSalt = SearchEngine::candidateSalt(m_jobDevice, c);
+	const std::string strAddress = SearchEngine::candidateAddress(m_job, m_jobDevice, c);
+
+	for (size_t i = 0; i < m_vScorers.size(); ++i) {
+		// Result scores are a byte like those of the device modes
+		const unsigned int score = std::min(m_vScorers[i]->score(strAddress, strSalt), 255U);
+
+		std::lock_guard<std::mutex> lock(m_mutexResult);
+		if (score > m_vScoreBest[i]) {
+			m_vScoreBest[i] = score;
+
+			result r;
+			std::memcpy(r.salt, strSalt.data(), sizeof(r.salt));
+			std::memcpy(r.hash, strAddress.data(), sizeof(r.hash));
+			r.deviceIndex = c.deviceIndex;
+			r.id = c.id;
+			r.round = c.round;
+			r.found = 1;
+
+			if (m_resultCallback) {
+				m_resultCallback(r, static_cast<cl_uchar>(score), i, c.deviceIndex);
+			}
+		}
+	}
+}
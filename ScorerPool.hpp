@@ -0,0 +1,65 @@
+#ifndef HPP_SCORERPOOL
+#define HPP_SCORERPOOL
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+#include "HostScorer.hpp"
+#include "SearchEngine.hpp"
+#include "types.hpp"
+
+/* Threads scoring the candidates of a job with the host scorers. Each candidate's salt and address are recomputed with
+ * sha3.cpp from the device index, global id and round it was found in. The queue is bounded so a prefilter that lets
+ * through more than the threads can score drops candidates instead of growing without limit, the drops are counted.
+ */
+class ScorerPool {
+	public:
+		// Invoked for every result that beats the best score of its scorer, never concurrently
+		typedef std::function<void(const result & r, const cl_uchar score, const size_t scorerIndex, const size_t deviceIndex)> ResultCallback;
+
+		struct Stats {
+			Stats();
+
+			cl_ulong scored;
+			cl_ulong dropped; // Didn't fit the device candidate buffer or the queue
+			size_t backlog;
+		};
+
+	public:
+		ScorerPool(const std::vector<std::shared_ptr<HostScorer>> & vScorers, const SearchEngine::Job & j, const job & jobDevice, const size_t threads, ResultCallback resultCallback);
+		~ScorerPool();
+
+		void push(const candidate * const pCandidates, const size_t count, const size_t dropped);
+		void finish(); // Scores everything queued and stops the threads
+		Stats stats();
+
+	private:
+		ScorerPool(ScorerPool & o);
+		ScorerPool & operator=(const ScorerPool & o);
+
+		void worker();
+		void score(const candidate & c);
+
+	private:
+		const std::vector<std::shared_ptr<HostScorer>> m_vScorers;
+		const SearchEngine::Job m_job;
+		const job m_jobDevice;
+		const ResultCallback m_resultCallback;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cvQueue;
+		std::deque<candidate> m_queue;
+		std::vector<std::thread> m_vThreads;
+		bool m_bFinish;
+		Stats m_stats;
+
+		std::mutex m_mutexResult;
+		std::vector<unsigned int> m_vScoreBest;
+};
+
+#endif /* HPP_SCORERPOOL */
@@ -0,0 +1,1092 @@
+#include "SearchEngine.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <map>
+
+#include "hexadecimal.hpp"
+#include "lexical_cast.hpp"
+#include "ModeFactory.hpp"
+#include "ResultVerifier.hpp"
+#include "ScorerPool.hpp"
+#include "kernels.hpp"
+#include "sha3.hpp"
+
+// Bytes absorbed per Keccak-f permutation by keccak256
+#define ERADICATE2_KECCAK_RATE 136
+
+static std::string readFile(const std::string & strFilename) {
+	std::ifstream in(strFilename, std::ios::in | std::ios::binary);
+	if (!in.is_open()) {
+		throw std::runtime_error("failed to open kernel file \"" + strFilename + "\"");
+	}
+
+	std::ostringstream contents;
+	contents << in.rdbuf();
+	return contents.str();
+}
+
+static std::vector<cl_device_id> getAllDevices(cl_device_type deviceType = CL_DEVICE_TYPE_GPU)
+{
+	std::vector<cl_device_id> vDevices;
+
+	cl_uint platformIdCount = 0;
+	clGetPlatformIDs (0, NULL, &platformIdCount);
+
+	std::vector<cl_platform_id> platformIds (platformIdCount);
+	clGetPlatformIDs (platformIdCount, platformIds.data (), NULL);
+
+	for( auto it = platformIds.cbegin(); it != platformIds.cend(); ++it ) {
+		// Platforms without any device of the requested type report CL_DEVICE_NOT_FOUND
+		cl_uint countDevice = 0;
+		if (clGetDeviceIDs(*it, deviceType, 0, NULL, &countDevice) != CL_SUCCESS || countDevice == 0) {
+			continue;
+		}
+
+		std::vector<cl_device_id> deviceIds(countDevice);
+		clGetDeviceIDs(*it, deviceType, countDevice, deviceIds.data(), &countDevice);
+
+		std::copy( deviceIds.begin(), deviceIds.end(), std::back_inserter(vDevices) );
+	}
+
+	return vDevices;
+}
+
+// Devices of OpenCL 2.1 and later list the intermediate languages they accept, older ones fail the query
+static bool deviceAcceptsSpirv(const std::vector<cl_device_id> & vDevices) {
+	for (auto & clDeviceId : vDevices) {
+		size_t len = 0;
+		if (clGetDeviceInfo(clDeviceId, CL_DEVICE_IL_VERSION, 0, NULL, &len) != CL_SUCCESS || len == 0) {
+			return false;
+		}
+
+		std::vector<char> vVersion(len);
+		if (clGetDeviceInfo(clDeviceId, CL_DEVICE_IL_VERSION, len, vVersion.data(), NULL) != CL_SUCCESS || std::string(vVersion.data()).find("SPIR-V") == std::string::npos) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static std::string deviceTypeName(const cl_device_type type) {
+	if (type & CL_DEVICE_TYPE_GPU) {
+		return "GPU";
+	} else if (type & CL_DEVICE_TYPE_CPU) {
+		return "CPU";
+	} else if (type & CL_DEVICE_TYPE_ACCELERATOR) {
+		return "accelerator";
+	}
+
+	return "other";
+}
+
+template <typename T, typename U, typename V, typename W>
+T clGetWrapper(U function, V param, W param2) {
+	T t;
+	function(param, param2, sizeof(t), &t, NULL);
+	return t;
+}
+
+template <typename T, typename U, typename V, typename W, typename X>
+T clGetWrapper(U function, V param, W param2, X param3) {
+	T t;
+	function(param, param2, param3, sizeof(t), &t, NULL);
+	return t;
+}
+
+template <typename U, typename V, typename W>
+std::string clGetWrapperString(U function, V param, W param2) {
+	size_t len;
+	function(param, param2, 0, NULL, &len);
+	char * const szString = new char[len];
+	function(param, param2, len, szString, NULL);
+	std::string r(szString);
+	delete[] szString;
+	return r;
+}
+
+template <typename T> bool printResult(std::ostream & os, const T & t, const cl_int & err) {
+	os << ((t == NULL) ? lexical_cast::write(err) : "OK") << std::endl;
+	return t == NULL;
+}
+
+static bool printResult(std::ostream & os, const cl_int err) {
+	os << ((err != CL_SUCCESS) ? lexical_cast::write(err) : "OK") << std::endl;
+	return err != CL_SUCCESS;
+}
+
+SearchEngine::Config::Config() :
+	deviceType(CL_DEVICE_TYPE_GPU),
+	worksizeLocal(128),
+	worksizeMax(0),
+	size(16777216),
+	strKeccak("loop"),
+	bHistogram(false),
+	strDispatch("callback"),
+	scorerThreads(0),
+	bVerify(true),
+	dutyCycle(1),
+	bYield(false),
+	pLog(NULL)
+{
+
+}
+
+SearchEngine::Job::Job() :
+	bCreate3(false),
+	scoreMax(0),
+	scoreTarget(0),
+	candidateMode(ModeFactory::benchmark()),
+	candidateScore(0),
+	initCodeVariableOffset(0),
+	initCodeVariableSize(0),
+	seed(0),
+	deviceIndexBase(0),
+	roundBase(0)
+{
+
+}
+
+SearchEngine::SearchEngine(const Config & config) :
+	m_config(config),
+	m_logNull(NULL),
+	m_bInitialized(false),
+	m_pTrace(config.strTrace.empty() ? NULL : new Trace()),
+	m_dispatcher(dispatchModel(config.strDispatch), config.bHistogram, [this](const size_t deviceIndex, const std::string & strProblem, const bool bRetry) { deviceError(deviceIndex, strProblem, bRetry); }, m_pTrace.get(), config.dutyCycle, config.bYield)
+{
+
+}
+
+SearchEngine::~SearchEngine() {
+	stop();
+	wait();
+
+	if (m_pTrace) {
+		try {
+			m_pTrace->write(m_config.strTrace);
+			log() << "Trace written to " << m_config.strTrace << std::endl;
+		} catch (std::runtime_error & e) {
+			log() << "warning: " << e.what() << std::endl;
+		}
+	}
+
+	for (auto & clProgram : m_vPrograms) {
+		clReleaseProgram(clProgram);
+	}
+
+	for (auto & clContext : m_vContexts) {
+		clReleaseContext(clContext);
+	}
+
+	for (auto & clSubDevice : m_vSubDevices) {
+		clReleaseDevice(clSubDevice);
+	}
+}
+
+std::ostream & SearchEngine::log() {
+	return m_config.pLog == NULL ? m_logNull : *m_config.pLog;
+}
+
+std::string SearchEngine::readKernel(const std::string & strFilename) const {
+	if (m_config.strKernelPath.empty()) {
+		return strFilename == "keccak.cl" ? g_szKeccakSource : g_szEradicate2Source;
+	}
+
+	return readFile(m_config.strKernelPath + "/" + strFilename);
+}
+
+std::string SearchEngine::keccakDigest(const std::string & data) {
+	char digest[32];
+	sha3(data.c_str(), data.size(), digest, 32);
+	return std::string(digest, 32);
+}
+
+// Digest of data read in chunks, either raw or hexadecimal with an optional 0x prefix and surrounding whitespace. The data
+// itself is never held in memory unless pData is set, it's then appended there.
+std::string SearchEngine::keccakDigest(std::istream & in, const bool bHex, std::string * const pData) {
+	enum { Leading, Prefix, Digits, Trailing } state = Leading;
+	std::vector<char> vChunk(1024 * 1024);
+	std::vector<char> vBytes(vChunk.size());
+	int nibble = -1;
+	sha3_ctx_t ctx;
+	sha3_init(&ctx, 32);
+
+	auto hexDigit = [](const char c) { return c >= '0' && c <= '9' ? c - '0' : (c >= 'a' && c <= 'f' ? c - 'a' + 10 : (c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1)); };
+	auto isSpace = [](const char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; };
+
+	while (in) {
+		in.read(vChunk.data(), vChunk.size());
+		const size_t size = static_cast<size_t>(in.gcount());
+		size_t count = 0;
+
+		for (size_t i = 0; i < size && bHex; ++i) {
+			const char c = vChunk[i];
+			const int value = hexDigit(c);
+
+			if (state == Leading && isSpace(c)) {
+				continue;
+			} else if (state == Leading && c == '0') {
+				state = Prefix;
+				continue;
+			} else if (state == Prefix && (c == 'x' || c == 'X')) {
+				state = Digits;
+				continue;
+			} else if (state == Prefix) {
+				// The leading 0 was a digit after all
+				nibble = 0;
+			}
+
+			if ((state == Digits || state == Prefix) && isSpace(c)) {
+				state = Trailing;
+			} else if (state != Trailing && value >= 0) {
+				state = Digits;
+				if (nibble == -1) {
+					nibble = value;
+				} else {
+					vBytes[count++] = static_cast<char>(nibble * 16 + value);
+					nibble = -1;
+				}
+			} else if (!isSpace(c) || state != Trailing) {
+				throw std::runtime_error("malformatted hexadecimal data");
+			}
+		}
+
+		const char * const pBytes = bHex ? vBytes.data() : vChunk.data();
+		count = bHex ? count : size;
+
+		sha3_update(&ctx, pBytes, count);
+		if (pData) {
+			pData->append(pBytes, count);
+		}
+	}
+
+	if (nibble != -1 || state == Prefix) {
+		throw std::runtime_error("malformatted hexadecimal data");
+	}
+
+	char digest[32];
+	sha3_final(digest, &ctx);
+	return std::string(digest, 32);
+}
+
+// Template is the salt in hexadecimal with the variable bytes written as "xx". Bytes left out at the end are variable.
+void SearchEngine::parseSaltTemplate(const std::string & strTemplate, std::string & strSaltTemplate, std::string & strSaltVariable) {
+	std::string o = strTemplate;
+	if (o.size() >= 2 && o.substr(0, 2) == "0x") {
+		o.erase(0, 2);
+	}
+
+	if (o.size() % 2 != 0 || o.size() > 64) {
+		throw std::runtime_error("malformatted salt template");
+	}
+
+	strSaltTemplate.assign(32, 0);
+	strSaltVariable.assign(32, 1);
+
+	for (size_t i = 0; i < o.size(); i += 2) {
+		const bool bHi = o[i] == 'x' || o[i] == 'X';
+		const bool bLo = o[i + 1] == 'x' || o[i + 1] == 'X';
+		if (bHi != bLo) {
+			throw std::runtime_error("salt template can only mark whole bytes as variable");
+		}
+
+		if (!bHi) {
+			strSaltTemplate[i / 2] = static_cast<char>(hexValue(o[i]) * 16 + hexValue(o[i + 1]));
+			strSaltVariable[i / 2] = 0;
+		}
+	}
+}
+
+// A hexadecimal number of at most 160 bits as 20 big endian bytes, like an address
+static std::string constraintBytes(std::string o) {
+	if (o.size() >= 2 && o.substr(0, 2) == "0x") {
+		o.erase(0, 2);
+	}
+
+	if (o.empty() || o.size() > 40) {
+		throw std::runtime_error("malformatted constraint");
+	}
+
+	std::string r(20, '\0');
+	for (size_t i = 0; i < o.size(); ++i) {
+		r[19 - i / 2] |= static_cast<char>(hexValue(o[o.size() - 1 - i]) << (4 * (i % 2)));
+	}
+
+	return r;
+}
+
+// Constraint given as <mask>:<value>, e.g. 0x3fff:0x0a80 for a Uniswap v4 hook with those permission flags
+void SearchEngine::parseConstraint(const std::string & strConstraint, std::string & strMask, std::string & strValue) {
+	const size_t pos = strConstraint.find(':');
+	if (pos == std::string::npos) {
+		throw std::runtime_error("constraint must be given as <mask>:<value>");
+	}
+
+	strMask = constraintBytes(strConstraint.substr(0, pos));
+	strValue = constraintBytes(strConstraint.substr(pos + 1));
+
+	for (size_t i = 0; i < 20; ++i) {
+		if (strValue[i] & ~strMask[i]) {
+			throw std::runtime_error("constraint value has bits outside the mask");
+		}
+	}
+}
+
+bool SearchEngine::constraintPass(const Job & j, const std::string & strAddress) {
+	for (size_t i = 0; i < j.strConstraintMask.size(); ++i) {
+		if ((strAddress[i] ^ j.strConstraintValue[i]) & j.strConstraintMask[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// The 12 byte counter goes in the last bytes of the variable init code field. Whole blocks before the counter never change
+// so they are absorbed here once, the kernel continues from that midstate.
+static size_t initCodeCounterPosition(const SearchEngine::Job & j) {
+	if (j.initCodeVariableSize < 12 || j.initCodeVariableOffset + j.initCodeVariableSize > j.strInitCode.size()) {
+		throw std::runtime_error("variable init code field must be at least 12 bytes and inside the init code");
+	}
+
+	return j.initCodeVariableOffset + j.initCodeVariableSize - 12;
+}
+
+static cl_ulong laneRead(const std::string & s, const size_t offset) {
+	cl_ulong r = 0;
+	for (size_t i = 0; i < 8; ++i) {
+		r |= static_cast<cl_ulong>(static_cast<cl_uchar>(s[offset + i])) << (8 * i);
+	}
+
+	return r;
+}
+
+std::vector<cl_ulong> SearchEngine::initCodeTail(const Job & j) {
+	std::vector<cl_ulong> vTail;
+	if (j.initCodeVariableSize == 0) {
+		return vTail;
+	}
+
+	const size_t blockFirst = initCodeCounterPosition(j) / ERADICATE2_KECCAK_RATE;
+	std::string strTail = j.strInitCode.substr(blockFirst * ERADICATE2_KECCAK_RATE);
+	const size_t sizeUnpadded = strTail.size();
+
+	strTail.resize((sizeUnpadded / ERADICATE2_KECCAK_RATE + 1) * ERADICATE2_KECCAK_RATE, '\0');
+	strTail[sizeUnpadded] ^= 0x01;
+	strTail[strTail.size() - 1] ^= static_cast<char>(0x80);
+
+	for (size_t i = 0; i < strTail.size(); i += 8) {
+		vTail.push_back(laneRead(strTail, i));
+	}
+
+	return vTail;
+}
+
+std::string SearchEngine::initCodeVariant(const Job & j, const job & jobDevice, const candidate & c) {
+	std::string r = j.strInitCode;
+	if (j.initCodeVariableSize == 0) {
+		return r;
+	}
+
+	const size_t position = initCodeCounterPosition(j);
+	const cl_ulong lo = c.deviceIndex | (static_cast<cl_ulong>(c.id) << 32);
+	const cl_ulong hi = static_cast<cl_uint>(c.round + jobDevice.roundBase);
+
+	for (int i = 0; i < 8; ++i) {
+		r[position + i] ^= static_cast<char>(lo >> (8 * i));
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		r[position + 8 + i] ^= static_cast<char>(hi >> (8 * i));
+	}
+
+	return r;
+}
+
+job SearchEngine::makeJob(const Job & j) {
+	const bool bInitCodeVariable = j.initCodeVariableSize != 0;
+	if (j.strAddressBinary.size() != 20 || (j.strInitCodeDigest.size() != 32 && !bInitCodeVariable)) {
+		throw std::runtime_error("address must be 20 bytes and init code digest 32 bytes");
+	}
+
+	const bool bTemplate = !j.strSaltVariable.empty();
+	if (bTemplate && (j.strSaltTemplate.size() != 32 || j.strSaltVariable.size() != 32)) {
+		throw std::runtime_error("salt template must be 32 bytes");
+	}
+
+	const bool bSafe = !j.strSafeInitializerDigest.empty();
+	if (bSafe && (j.strSafeInitializerDigest.size() != 32 || bTemplate || bInitCodeVariable)) {
+		throw std::runtime_error("Safe initializer digest must be 32 bytes and can't be combined with a salt template or a variable init code field");
+	}
+
+	if (j.strConstraintMask.size() != j.strConstraintValue.size() || (!j.strConstraintMask.empty() && j.strConstraintMask.size() != 20)) {
+		throw std::runtime_error("constraint mask and value must be 20 bytes");
+	}
+
+	job r = job();
+
+	// Mask and value laid out like the address in lanes 1 to 3 of the hash
+	for (size_t i = 0; i < j.strConstraintMask.size(); ++i) {
+		const size_t lane = (i + 12) / 8 - 1;
+		const size_t shift = 8 * ((i + 12) % 8);
+		r.constraintMask[lane] |= static_cast<cl_ulong>(static_cast<cl_uchar>(j.strConstraintMask[i])) << shift;
+		r.constraintValue[lane] |= static_cast<cl_ulong>(static_cast<cl_uchar>(j.strConstraintValue[i])) << shift;
+	}
+
+	if (bInitCodeVariable) {
+		const size_t blockFirst = initCodeCounterPosition(j) / ERADICATE2_KECCAK_RATE;
+		ethhash & m = r.initCodeMidstate;
+
+		for (size_t b = 0; b < blockFirst; ++b) {
+			for (size_t i = 0; i < ERADICATE2_KECCAK_RATE / 8; ++i) {
+				m.q[i] ^= laneRead(j.strInitCode, b * ERADICATE2_KECCAK_RATE + i * 8);
+			}
+
+			sha3_keccakf(m.q);
+		}
+
+		r.initCodeBlocks = static_cast<cl_uint>(initCodeTail(j).size() / (ERADICATE2_KECCAK_RATE / 8));
+		r.initCodeCounterOffset = static_cast<cl_uint>(initCodeCounterPosition(j) - blockFirst * ERADICATE2_KECCAK_RATE);
+	}
+
+	// The kernel writes its 12 byte counter into the variable part. Prefer a window spanning as few lanes as possible
+	// and starting on a lane boundary. With a variable init code field the salt doesn't change at all. Safe jobs vary the
+	// saltNonce following the initializer digest in the salt preimage.
+	int bestCost = bInitCodeVariable ? 0 : -1;
+	for (int p = 0; p + 12 <= 32 && !bInitCodeVariable; ++p) {
+		bool bVariable = true;
+		for (int k = p; k < p + 12 && bTemplate; ++k) {
+			bVariable = bVariable && j.strSaltVariable[k] != 0;
+		}
+
+		const int offset = p + (bSafe ? 32 : 21);
+		const int cost = ((offset + 11) / 8 - offset / 8) * 2 + (offset % 8 != 0);
+		if (bVariable && (bestCost == -1 || cost < bestCost)) {
+			bestCost = cost;
+			r.saltOffset = offset;
+		}
+	}
+
+	if (bestCost == -1) {
+		throw std::runtime_error("salt template must leave at least 12 consecutive variable bytes");
+	}
+
+	std::random_device rd;
+	std::mt19937_64 eng(j.seed != 0 ? j.seed : rd());
+	std::uniform_int_distribution<unsigned int> distr; // C++ requires integer type: "C2338	note : char, signed char, unsigned char, int8_t, and uint8_t are not allowed"
+	ethhash & h = r.init;
+
+	h.b[0] = 0xff;
+	for (int i = 0; i < 20; ++i) {
+		h.b[i + 1] = j.strAddressBinary[i];
+	}
+
+	// Gas mode counting salt zero bytes wants everything but the counter zero, the seeded round base keeps runs apart
+	bool bZeroFill = false;
+	for (auto & m : j.vModes) {
+		bZeroFill = bZeroFill || (m.function == ModeFunction::Gas && m.data1[0] != 0);
+	}
+
+	if (bZeroFill && bInitCodeVariable) {
+		throw std::runtime_error("gas mode counting the salt needs a varying salt");
+	}
+
+	for (int i = 0; i < 32; ++i) {
+		const cl_uchar fill = bZeroFill ? 0 : static_cast<cl_uchar>(distr(eng));
+		if (bSafe) {
+			r.safeSalt.b[i + 32] = fill;
+		} else {
+			h.b[i + 21] = (!bTemplate || j.strSaltVariable[i]) ? fill : j.strSaltTemplate[i];
+		}
+	}
+
+	// Rounds count on from a base drawn from the seed, a zero filled salt or varied init code would otherwise repeat every earlier run
+	r.roundBase = j.roundBase + static_cast<cl_uint>(distr(eng));
+
+	// keccak256(initializer) ++ saltNonce, the salt lanes of the CREATE2 preimage stay zero for the kernel to XOR its digest into
+	if (bSafe) {
+		for (int i = 0; i < 32; ++i) {
+			r.safeSalt.b[i] = j.strSafeInitializerDigest[i];
+		}
+
+		r.safeSalt.b[64] ^= 0x01;
+		r.safe = 1;
+	}
+
+	// Gas mode counting the salt adds the zero bytes the counter leaves alone
+	const ethhash & salt = bSafe ? r.safeSalt : h;
+	const cl_uint saltFirst = bSafe ? 32 : 21;
+	for (cl_uint i = saltFirst; i < saltFirst + 32; ++i) {
+		r.saltZeroBytes += (i < r.saltOffset || i >= r.saltOffset + 12) && salt.b[i] == 0;
+	}
+
+	// The kernel XORs in the digest of each init code variant
+	for (int i = 0; i < 32 && !bInitCodeVariable; ++i) {
+		h.b[i + 53] = j.strInitCodeDigest[i];
+	}
+
+	h.b[85] ^= 0x01;
+	r.create3 = j.bCreate3 ? 1 : 0;
+	r.modeCount = static_cast<cl_uint>(j.vModes.size());
+	r.candidateScore = j.vScorers.empty() ? 0 : j.candidateScore;
+
+	return r;
+}
+
+// Gas saved compared to an address (and salt) without zero bytes, see ModeFactory::gasSaved()
+unsigned int SearchEngine::gasSaved(const result & r, const bool bSalt) {
+	return ModeFactory::gasSaved(std::string(reinterpret_cast<const char *>(r.hash), 20), bSalt ? std::string(reinterpret_cast<const char *>(r.salt), 32) : std::string());
+}
+
+// Salt a candidate was hashed with, unless the init code varies the template salt with the 96 bit counter of eradicate2_salt_apply() XORed in.
+// For Safe jobs this is the saltNonce, see safeSalt().
+std::string SearchEngine::candidateSalt(const job & j, const candidate & c) {
+	if (j.initCodeBlocks) {
+		return std::string(reinterpret_cast<const char *>(j.init.b + 21), 32);
+	}
+
+	const cl_ulong lo = c.deviceIndex | (static_cast<cl_ulong>(c.id) << 32);
+	const cl_ulong hi = static_cast<cl_uint>(c.round + j.roundBase);
+	ethhash h = j.safe ? j.safeSalt : j.init;
+
+	for (int i = 0; i < 8; ++i) {
+		h.b[j.saltOffset + i] ^= static_cast<cl_uchar>(lo >> (8 * i));
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		h.b[j.saltOffset + 8 + i] ^= static_cast<cl_uchar>(hi >> (8 * i));
+	}
+
+	return std::string(reinterpret_cast<const char *>(h.b + (j.safe ? 32 : 21)), 32);
+}
+
+// Address a candidate deploys to, the CREATE3 address for CREATE3 jobs
+std::string SearchEngine::candidateAddress(const Job & j, const job & jobDevice, const candidate & c) {
+	const std::string strInitCodeDigest = j.initCodeVariableSize ? keccakDigest(initCodeVariant(j, jobDevice, c)) : j.strInitCodeDigest;
+	const std::string strSalt = j.strSafeInitializerDigest.empty() ? candidateSalt(jobDevice, c) : safeSalt(j.strSafeInitializerDigest, candidateSalt(jobDevice, c));
+	const std::string strAddress = create2Address(j.strAddressBinary, strSalt, strInitCodeDigest);
+	return j.bCreate3 ? create3Address(strAddress) : strAddress;
+}
+
+// CREATE2 salt of the Safe ProxyFactory, keccak256(abi.encodePacked(keccak256(initializer), saltNonce))
+std::string SearchEngine::safeSalt(const std::string & strInitializerDigest, const std::string & strSaltNonce) {
+	return keccakDigest(strInitializerDigest + strSaltNonce);
+}
+
+std::string SearchEngine::create2Address(const std::string & strAddressBinary, const std::string & strSalt, const std::string & strInitCodeDigest) {
+	const std::string strPreimage = std::string(1, '\xff') + strAddressBinary + strSalt + strInitCodeDigest;
+	return keccakDigest(strPreimage).substr(12);
+}
+
+std::string SearchEngine::create3Address(const std::string & strProxyBinary) {
+	const std::string strRlp = std::string("\xd6\x94") + strProxyBinary + std::string(1, '\x01');
+	return keccakDigest(strRlp).substr(12);
+}
+
+void SearchEngine::init() {
+	if (m_bInitialized) {
+		return;
+	}
+
+	std::vector<cl_device_id> vFoundDevices = getAllDevices(m_config.deviceType);
+	// Parsed once up front so a bad value fails before any device is touched
+	const std::vector<cl_device_partition_property> vPartition = partitionProperties(m_config.strPartition);
+
+	// Devices from different vendors live on different platforms and can't share a context
+	std::map<cl_platform_id, std::vector<cl_device_id>> mPlatformDevices;
+
+	// Sub-devices are numbered after all devices, the index is part of the salt so it must never repeat
+	size_t indexSubDevice = vFoundDevices.size();
+
+	log() << "Devices:" << std::endl;
+	for (size_t i = 0; i < vFoundDevices.size(); ++i) {
+		// Ignore devices in skip index
+		if (std::find(m_config.vDeviceSkipIndex.begin(), m_config.vDeviceSkipIndex.end(), i) != m_config.vDeviceSkipIndex.end()) {
+			continue;
+		}
+
+		DeviceInfo info;
+		info.index = i;
+		info.parentIndex = i;
+		info.clDeviceId = vFoundDevices[i];
+		info.clPlatformId = clGetWrapper<cl_platform_id>(clGetDeviceInfo, info.clDeviceId, CL_DEVICE_PLATFORM);
+		info.type = clGetWrapper<cl_device_type>(clGetDeviceInfo, info.clDeviceId, CL_DEVICE_TYPE);
+		info.strName = clGetWrapperString(clGetDeviceInfo, info.clDeviceId, CL_DEVICE_NAME);
+		info.computeUnits = clGetWrapper<cl_uint>(clGetDeviceInfo, info.clDeviceId, CL_DEVICE_MAX_COMPUTE_UNITS);
+		info.globalMemSize = clGetWrapper<cl_ulong>(clGetDeviceInfo, info.clDeviceId, CL_DEVICE_GLOBAL_MEM_SIZE);
+		info.privateMemSize = 0;
+		info.strKeccak = m_config.mDeviceKeccak.count(i) ? m_config.mDeviceKeccak.at(i) : m_config.strKeccak;
+		keccakBuildOption(info.strKeccak);
+
+		// A partitioned device is replaced by its sub-devices, each with its own queue and buffers
+		std::vector<DeviceInfo> vInfo;
+		for (auto & clSubDevice : partition(info, vPartition)) {
+			DeviceInfo sub = info;
+			sub.index = indexSubDevice++;
+			sub.clDeviceId = clSubDevice;
+			sub.computeUnits = clGetWrapper<cl_uint>(clGetDeviceInfo, clSubDevice, CL_DEVICE_MAX_COMPUTE_UNITS);
+			vInfo.push_back(sub);
+		}
+
+		if (vInfo.empty()) {
+			vInfo.push_back(info);
+		}
+
+		for (auto & d : vInfo) {
+			log() << "  GPU" << d.index << ": " << d.strName << ", " << d.globalMemSize << " bytes available, " << d.computeUnits << " compute units";
+			if (d.strKeccak != "loop") {
+				log() << ", " << d.strKeccak << " keccak";
+			}
+
+			if (d.parentIndex != d.index) {
+				log() << ", sub-device of GPU" << d.parentIndex;
+			}
+
+			if ((d.type & CL_DEVICE_TYPE_GPU) == 0) {
+				log() << " (" << deviceTypeName(d.type) << ")";
+			}
+			log() << std::endl;
+
+			m_vDevices.push_back(d);
+			mPlatformDevices[d.clPlatformId].push_back(d.clDeviceId);
+		}
+	}
+
+	if (m_vDevices.empty()) {
+		throw std::runtime_error("no OpenCL devices found");
+	}
+
+	log() << std::endl;
+	log() << "Initializing OpenCL..." << std::endl;
+
+	std::string strBuildOptions = "-D ERADICATE2_MAX_SCORE=" + lexical_cast::write(ERADICATE2_MAX_SCORE);
+	strBuildOptions += " -D ERADICATE2_MAX_MODES=" + lexical_cast::write(ERADICATE2_MAX_MODES);
+	strBuildOptions += " -D ERADICATE2_GAS_ZERO_BYTE=" + lexical_cast::write(ERADICATE2_GAS_ZERO_BYTE);
+	strBuildOptions += " -D ERADICATE2_GAS_LEADING_BYTE=" + lexical_cast::write(ERADICATE2_GAS_LEADING_BYTE);
+	strBuildOptions += " -D ERADICATE2_GAS_PER_SCORE=" + lexical_cast::write(ERADICATE2_GAS_PER_SCORE);
+	if (m_config.bHistogram) {
+		strBuildOptions += " -D ERADICATE2_HISTOGRAM";
+	}
+
+	// A platform that fails to initialize is skipped, the devices on the remaining platforms still run
+	size_t countPlatforms = 0;
+	for (auto & platform : mPlatformDevices) {
+		if (initPlatform(platform.first, platform.second, strBuildOptions)) {
+			++countPlatforms;
+		} else {
+			for (auto & info : m_vDevices) {
+				info.strFailure = info.clPlatformId == platform.first ? "platform failed to initialize" : info.strFailure;
+			}
+		}
+	}
+
+	log() << std::endl;
+
+	if (countPlatforms == 0) {
+		throw std::runtime_error("failed to initialize any OpenCL platform");
+	}
+
+	// Aggressive Keccak variants and driver bugs can produce wrong hashes, a device must get a small batch right first
+	if (m_config.bVerify) {
+		log() << "Testing devices..." << std::endl;
+
+		for (auto & info : m_vDevices) {
+			if (!info.strFailure.empty()) {
+				continue;
+			}
+
+			const std::string strProblem = selfTest(info.index);
+			log() << "  GPU" << info.index << ": " << (strProblem.empty() ? "ok" : "failed, " + strProblem + ", excluded") << std::endl;
+
+			if (!strProblem.empty()) {
+				info.strFailure = strProblem;
+				m_dispatcher.exclude(info.index);
+			}
+		}
+
+		log() << std::endl;
+	}
+
+	m_bInitialized = true;
+}
+
+// Runs a single round of four known jobs, CREATE2, CREATE3, a varied init code spanning two Keccak blocks and a Safe salt
+// nonce with a constraint, with modes spreading their results over many scores. Every result is recomputed on the host.
+std::string SearchEngine::selfTest(const size_t deviceIndex) {
+	Job j;
+	j.strAddressBinary = std::string("\xde\xad\xbe\xef\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\xc0\xff\xee\x00", 20);
+	j.strInitCodeDigest = keccakDigest("ERADICATE2");
+	j.vModes = { ModeFactory::letters(), ModeFactory::numbers(), ModeFactory::zeros(), ModeFactory::zerobytes(), ModeFactory::leadingRange(0, 7), ModeFactory::mirror(), ModeFactory::doubles(), ModeFactory::gas(false) };
+
+	// Enough hashes for a few dozen distinct scores, in whole work-groups
+	const size_t worksizeLocal = std::max<size_t>(m_config.worksizeLocal, 1);
+	const size_t size = std::max<size_t>(4096 / worksizeLocal, 1) * worksizeLocal;
+
+	for (int test = 0; test < 4; ++test) {
+		j.bCreate3 = test == 1;
+		if (test == 2) {
+			j.strInitCode.clear();
+			for (int i = 0; i < 300; ++i) {
+				j.strInitCode += static_cast<char>(i * 13 + 7);
+			}
+
+			j.initCodeVariableOffset = 140;
+			j.initCodeVariableSize = 32;
+		} else if (test == 3) {
+			j.initCodeVariableSize = 0;
+			j.strSafeInitializerDigest = keccakDigest("SAFE");
+			parseConstraint("0x3:0x1", j.strConstraintMask, j.strConstraintValue);
+		}
+
+		const job jobDevice = makeJob(j);
+		std::vector<result> vResults;
+		try {
+			vResults = m_dispatcher.runOnce(deviceIndex, j.vModes, jobDevice, initCodeTail(j), size);
+		} catch (std::runtime_error & e) {
+			return e.what();
+		}
+
+		size_t found = 0;
+		for (size_t i = 0; i < vResults.size(); ++i) {
+			const cl_uchar score = static_cast<cl_uchar>(i % (ERADICATE2_MAX_SCORE + 1));
+			if (vResults[i].found == 0 || score == 0) {
+				continue;
+			}
+
+			const std::string strProblem = ResultVerifier::verify(j, jobDevice, vResults[i], score, i / (ERADICATE2_MAX_SCORE + 1));
+			if (!strProblem.empty()) {
+				return strProblem;
+			}
+
+			++found;
+		}
+
+		if (found < 20) {
+			return "only " + lexical_cast::write(found) + " results";
+		}
+	}
+
+	return "";
+}
+
+// Sub-devices of a CPU device, empty if partitioning is off or the device can't be split in at least two
+std::vector<cl_device_id> SearchEngine::partition(const DeviceInfo & info, const std::vector<cl_device_partition_property> & vProperties) {
+	std::vector<cl_device_id> vSubDevices;
+	if (vProperties.empty() || (info.type & CL_DEVICE_TYPE_CPU) == 0) {
+		return vSubDevices;
+	}
+
+	cl_uint count = 0;
+	if (clCreateSubDevices(info.clDeviceId, vProperties.data(), 0, NULL, &count) != CL_SUCCESS || count < 2) {
+		log() << "  GPU" << info.index << ": can't be partitioned by " << m_config.strPartition << ", used whole" << std::endl;
+		return vSubDevices;
+	}
+
+	vSubDevices.resize(count);
+	if (clCreateSubDevices(info.clDeviceId, vProperties.data(), count, vSubDevices.data(), &count) != CL_SUCCESS) {
+		log() << "  GPU" << info.index << ": failed to create sub-devices, used whole" << std::endl;
+		vSubDevices.clear();
+		return vSubDevices;
+	}
+
+	vSubDevices.resize(count);
+	m_vSubDevices.insert(m_vSubDevices.end(), vSubDevices.begin(), vSubDevices.end());
+	return vSubDevices;
+}
+
+void SearchEngine::deviceFailed(const size_t deviceIndex, const std::string & strProblem) {
+	m_dispatcher.exclude(deviceIndex);
+
+	std::lock_guard<std::mutex> lock(m_mutexDevices);
+	for (auto & info : m_vDevices) {
+		if (info.index == deviceIndex) {
+			info.strFailure = strProblem;
+		}
+	}
+
+	log() << std::endl << "warning: GPU" << deviceIndex << " reported a wrong result, " << strProblem << ", excluded" << std::endl;
+}
+
+// OpenCL errors only take the device out of the running job, it's recreated for a later job unless it failed too often
+void SearchEngine::deviceError(const size_t deviceIndex, const std::string & strProblem, const bool bRetry) {
+	if (!bRetry) {
+		std::lock_guard<std::mutex> lock(m_mutexDevices);
+		for (auto & info : m_vDevices) {
+			if (info.index == deviceIndex) {
+				info.strFailure = strProblem;
+			}
+		}
+	}
+
+	log() << std::endl << "warning: GPU" << deviceIndex << " failed, " << strProblem << (bRetry ? ", retried with the next job" : ", excluded") << std::endl;
+}
+
+bool SearchEngine::initPlatform(cl_platform_id clPlatformId, std::vector<cl_device_id> & vDevices, const std::string & strBuildOptions) {
+	cl_int errorCode;
+
+	log() << "  Platform " << clGetWrapperString(clGetPlatformInfo, clPlatformId, CL_PLATFORM_NAME) << ":" << std::endl;
+	log() << "    Creating context..." << std::flush;
+	const cl_context_properties contextProperties[] = { CL_CONTEXT_PLATFORM, reinterpret_cast<cl_context_properties>(clPlatformId), 0 };
+	auto clContext = clCreateContext(contextProperties, vDevices.size(), vDevices.data(), NULL, NULL, &errorCode);
+	if (printResult(log(), clContext, errorCode)) {
+		return false;
+	}
+
+	m_vContexts.push_back(clContext);
+
+	// Devices using different Keccak implementations need programs built with different options
+	std::map<std::string, std::vector<cl_device_id>> mVariantDevices;
+	for (auto & info : m_vDevices) {
+		if (info.clPlatformId == clPlatformId) {
+			mVariantDevices[info.strKeccak].push_back(info.clDeviceId);
+		}
+	}
+
+	bool bAny = false;
+	for (auto & variant : mVariantDevices) {
+		cl_program clProgram = buildProgram(clContext, variant.second, strBuildOptions + keccakBuildOption(variant.first), variant.first);
+		if (clProgram == NULL) {
+			continue;
+		}
+
+		// The kernel is written to keep the whole Keccak state in registers, anything in private memory means the
+		// compiler spilled
+		cl_kernel clKernel = clCreateKernel(clProgram, "eradicate2_iterate", &errorCode);
+		for (auto & info : m_vDevices) {
+			if (info.clPlatformId == clPlatformId && info.strKeccak == variant.first && clKernel != NULL) {
+				info.privateMemSize = clGetWrapper<cl_ulong>(clGetKernelWorkGroupInfo, clKernel, info.clDeviceId, CL_KERNEL_PRIVATE_MEM_SIZE);
+				log() << "    GPU" << info.index << " private memory: " << info.privateMemSize << " bytes" << (info.privateMemSize > 0 ? " (spilling)" : "") << std::endl;
+			}
+		}
+
+		if (clKernel != NULL) {
+			clReleaseKernel(clKernel);
+		}
+
+		for (auto & info : m_vDevices) {
+			if (info.clPlatformId == clPlatformId && info.strKeccak == variant.first) {
+				m_dispatcher.addDevice(clContext, clProgram, info.clDeviceId, m_config.worksizeLocal, m_config.worksizeMax, m_config.size, info.index);
+			}
+		}
+
+		bAny = true;
+	}
+
+	return bAny;
+}
+
+cl_program SearchEngine::buildProgram(cl_context & clContext, std::vector<cl_device_id> & vDevices, const std::string & strBuildOptions, const std::string & strKeccak) {
+	cl_int errorCode;
+
+	// The embedded SPIR-V skips the compiler front end but is only built for the default options, anything else or a
+	// device rejecting it falls back to the source
+	if (m_config.strKernelPath.empty() && g_kernelILSize > 0 && strBuildOptions == g_szKernelILOptions && deviceAcceptsSpirv(vDevices)) {
+#ifdef CL_VERSION_2_1
+		log() << "    Loading SPIR-V (" << strKeccak << ")..." << std::flush;
+		cl_program clProgram = clCreateProgramWithIL(clContext, g_kernelIL, g_kernelILSize, &errorCode);
+		if (!printResult(log(), clProgram, errorCode)) {
+			m_vPrograms.push_back(clProgram);
+			if (compileProgram(clProgram, vDevices, strBuildOptions)) {
+				return clProgram;
+			}
+		}
+#endif
+	}
+
+	// Create a program from the kernel source
+	log() << "    Compiling kernel (" << strKeccak << ")..." << std::flush;
+	const std::string strKeccakSource = readKernel("keccak.cl");
+	const std::string strVanity = readKernel("eradicate2.cl");
+	const char * szKernels[] = { strKeccakSource.c_str(), strVanity.c_str() };
+
+	cl_program clProgram = clCreateProgramWithSource(clContext, sizeof(szKernels) / sizeof(char *), szKernels, NULL, &errorCode);
+	if (printResult(log(), clProgram, errorCode)) {
+		return NULL;
+	}
+
+	m_vPrograms.push_back(clProgram);
+	return compileProgram(clProgram, vDevices, strBuildOptions) ? clProgram : NULL;
+}
+
+bool SearchEngine::compileProgram(cl_program & clProgram, std::vector<cl_device_id> & vDevices, const std::string & strBuildOptions) {
+	log() << "    Building program..." << std::flush;
+	if (printResult(log(), clBuildProgram(clProgram, vDevices.size(), vDevices.data(), strBuildOptions.c_str(), NULL, NULL))) {
+#ifdef ERADICATE2_DEBUG
+		log() << std::endl;
+		log() << "build log:" << std::endl;
+
+		size_t sizeLog;
+		clGetProgramBuildInfo(clProgram, vDevices[0], CL_PROGRAM_BUILD_LOG, 0, NULL, &sizeLog);
+		char * const szLog = new char[sizeLog];
+		clGetProgramBuildInfo(clProgram, vDevices[0], CL_PROGRAM_BUILD_LOG, sizeLog, szLog, NULL);
+
+		log() << szLog << std::endl;
+		delete[] szLog;
+#endif
+		return false;
+	}
+
+	return true;
+}
+
+// Keccak-f implementations in keccak.cl, the fastest one depends on the device
+std::string SearchEngine::keccakBuildOption(const std::string & strKeccak) {
+	if (strKeccak == "loop") {
+		return "";
+	} else if (strKeccak == "unrolled") {
+		return " -D ERADICATE2_KECCAK_UNROLLED";
+	} else if (strKeccak == "bitselect") {
+		return " -D ERADICATE2_KECCAK_BITSELECT";
+	} else if (strKeccak == "complement") {
+		return " -D ERADICATE2_KECCAK_COMPLEMENT";
+	} else if (strKeccak == "interleaved") {
+		return " -D ERADICATE2_KECCAK_INTERLEAVED";
+	}
+
+	throw std::runtime_error("unknown keccak implementation \"" + strKeccak + "\"");
+}
+
+std::vector<cl_device_partition_property> SearchEngine::partitionProperties(const std::string & strPartition) {
+	if (strPartition.empty()) {
+		return std::vector<cl_device_partition_property>();
+	} else if (strPartition == "numa") {
+		return { CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN, CL_DEVICE_AFFINITY_DOMAIN_NUMA, 0 };
+	}
+
+	const cl_uint computeUnits = lexical_cast::read<cl_uint>(strPartition);
+	if (computeUnits == 0 || lexical_cast::write(computeUnits) != strPartition) {
+		throw std::runtime_error("unknown partitioning \"" + strPartition + "\"");
+	}
+
+	return { CL_DEVICE_PARTITION_EQUALLY, static_cast<cl_device_partition_property>(computeUnits), 0 };
+}
+
+Dispatcher::DispatchModel SearchEngine::dispatchModel(const std::string & strDispatch) {
+	if (strDispatch == "callback") {
+		return Dispatcher::DispatchModel::Callback;
+	} else if (strDispatch == "thread") {
+		return Dispatcher::DispatchModel::Thread;
+	} else if (strDispatch == "poll") {
+		return Dispatcher::DispatchModel::Poll;
+	}
+
+	throw std::runtime_error("unknown dispatch model \"" + strDispatch + "\"");
+}
+
+const std::vector<SearchEngine::DeviceInfo> & SearchEngine::devices() const {
+	return m_vDevices;
+}
+
+void SearchEngine::start(const Job & job, ResultCallback resultCallback, ProgressCallback progressCallback) {
+	init();
+
+	if (!job.vScorers.empty() && job.candidateScore == 0) {
+		throw std::runtime_error("host scorers need a candidate score");
+	}
+
+	// The variable init code bytes before the counter are random so runs don't repeat
+	m_jobRun = job;
+	if (job.initCodeVariableSize > 12 && job.initCodeVariableOffset + job.initCodeVariableSize <= job.strInitCode.size()) {
+		std::random_device rd;
+		std::mt19937_64 eng(rd());
+		std::uniform_int_distribution<unsigned int> distr;
+
+		for (size_t i = 0; i < job.initCodeVariableSize - 12; ++i) {
+			m_jobRun.strInitCode[job.initCodeVariableOffset + i] = static_cast<char>(distr(eng));
+		}
+	}
+
+	m_jobDevice = makeJob(m_jobRun);
+	Dispatcher::CandidateCallback candidateCallback;
+	m_pScorerPool.reset();
+
+	if (!job.vScorers.empty()) {
+		const size_t modeCount = job.vModes.size();
+		auto scorerCallback = [resultCallback, modeCount](const result & r, const cl_uchar score, const size_t scorerIndex, const size_t deviceIndex) {
+			resultCallback(r, score, modeCount + scorerIndex, deviceIndex);
+		};
+
+		m_pScorerPool.reset(new ScorerPool(job.vScorers, m_jobRun, m_jobDevice, m_config.scorerThreads, scorerCallback));
+
+		ScorerPool * const pScorerPool = m_pScorerPool.get();
+		candidateCallback = [pScorerPool](const candidate * pCandidates, const size_t count, const size_t dropped, const size_t deviceIndex) {
+			pScorerPool->push(pCandidates, count, dropped);
+		};
+	}
+
+	// Device results are passed on once the host agrees with them
+	Dispatcher::ResultCallback deviceCallback = resultCallback;
+	m_pResultVerifier.reset();
+
+	if (m_config.bVerify) {
+		m_pResultVerifier.reset(new ResultVerifier(m_jobRun, m_jobDevice, resultCallback, [this](const size_t deviceIndex, const std::string & strProblem) { deviceFailed(deviceIndex, strProblem); }));
+
+		ResultVerifier * const pResultVerifier = m_pResultVerifier.get();
+		deviceCallback = [pResultVerifier](const result & r, const cl_uchar score, const size_t modeIndex, const size_t deviceIndex) {
+			pResultVerifier->push(r, score, modeIndex, deviceIndex);
+		};
+	}
+
+	std::vector<cl_uchar> vScoreMax = job.vScoreMax;
+	vScoreMax.resize(job.vModes.size(), job.scoreMax);
+
+	m_dispatcher.start(job.vModes, m_jobDevice, job.deviceIndexBase, initCodeTail(m_jobRun), vScoreMax, job.scoreTarget, deviceCallback, progressCallback, job.candidateMode, candidateCallback);
+}
+
+void SearchEngine::stop() {
+	m_dispatcher.stop();
+}
+
+void SearchEngine::wait() {
+	m_dispatcher.wait();
+
+	// The devices are done, what's left is verifying the last results and scoring the queued candidates
+	if (m_pResultVerifier) {
+		m_pResultVerifier->finish();
+	}
+
+	if (m_pScorerPool) {
+		m_pScorerPool->finish();
+	}
+}
+
+void SearchEngine::candidateStats(cl_ulong & scored, cl_ulong & dropped, size_t & backlog) {
+	const ScorerPool::Stats stats = m_pScorerPool ? m_pScorerPool->stats() : ScorerPool::Stats();
+	scored = stats.scored;
+	dropped = stats.dropped;
+	backlog = stats.backlog;
+}
+
+std::string SearchEngine::initCode(const result & r) const {
+	candidate c;
+	c.deviceIndex = r.deviceIndex;
+	c.id = r.id;
+	c.round = r.round;
+	return initCodeVariant(m_jobRun, m_jobDevice, c);
+}
+
+cl_uint SearchEngine::rounds() {
+	return m_dispatcher.rounds();
+}
+
+bool SearchEngine::running() {
+	return m_dispatcher.running();
+}
+
+void SearchEngine::raiseScoreMax(const size_t modeIndex, const cl_uchar score) {
+	m_dispatcher.raiseScoreMax(modeIndex, score);
+}
+
+SearchEngine::Histogram SearchEngine::histogram(const size_t deviceIndex) {
+	return m_dispatcher.histogram(deviceIndex);
+}
+
+std::map<size_t, double> SearchEngine::benchmarkDispatch(const std::string & strDispatch, const unsigned int rounds) {
+	init();
+
+	return m_dispatcher.benchmarkRoundTrip(dispatchModel(strDispatch), rounds);
+}
@@ -0,0 +1,185 @@
+#ifndef HPP_SEARCHENGINE
+#define HPP_SEARCHENGINE
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <vector>
+
+#if defined(__APPLE__) || defined(__MACOSX)
+#include <OpenCL/cl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+#include "Dispatcher.hpp"
+#include "HostScorer.hpp"
+#include "Trace.hpp"
+#include "types.hpp"
+
+class ResultVerifier;
+class ScorerPool;
+
+/* Embeddable front end to the search. Devices are discovered and programs built once in init(), after
+ * which any number of jobs can be run back to back on the same contexts, queues and buffers. The job
+ * specific data (deployer, init code digest and random salt) is uploaded to the devices as a buffer so
+ * switching jobs never recompiles anything.
+ */
+class SearchEngine {
+	public:
+		struct Config {
+			Config();
+
+			cl_device_type deviceType;
+			std::vector<size_t> vDeviceSkipIndex;
+			size_t worksizeLocal;
+			size_t worksizeMax; // 0 means same as size
+			size_t size;
+			std::string strKernelPath; // Directory holding keccak.cl and eradicate2.cl, empty for the kernels embedded in the executable
+			std::string strKeccak; // Keccak-f implementation: loop, unrolled, bitselect, complement or interleaved
+			std::map<size_t, std::string> mDeviceKeccak; // Per device index overrides of strKeccak
+			std::string strPartition; // Split CPU devices into sub-devices: numa, or compute units per sub-device. Empty keeps them whole.
+			bool bHistogram; // Count every score on the devices, see histogram()
+			std::string strDispatch; // Dispatch model: callback, thread or poll
+			size_t scorerThreads; // Threads running the host scorers, 0 means one per hardware thread
+			bool bVerify; // Known-answer test of every device in init() and host verification of every result, see ResultVerifier
+			std::string strTrace; // Chrome trace of every round is written to this file when the engine is destroyed, see Trace
+			double dutyCycle; // Share of the time the devices are kept busy, 1 for all of it. See Dispatcher.
+			bool bYield; // Devices back off while other work slows their rounds down
+			std::ostream * pLog; // Initialization progress is written here if set
+		};
+
+		struct DeviceInfo {
+			size_t index;
+			size_t parentIndex; // Index of the partitioned device for sub-devices, otherwise same as index
+			cl_device_id clDeviceId;
+			cl_platform_id clPlatformId;
+			cl_device_type type;
+			std::string strName;
+			cl_ulong globalMemSize;
+			cl_uint computeUnits;
+			cl_ulong privateMemSize; // Private memory used by the kernel per work item, non-zero means register spills
+			std::string strKeccak;
+			std::string strFailure; // Why the device was excluded, empty for a healthy device
+		};
+
+		struct Job {
+			Job();
+
+			std::string strAddressBinary; // 20 byte deployer address
+			std::string strInitCodeDigest; // 32 byte keccak256 of the init code
+			std::string strSaltTemplate; // 32 byte salt, only the bytes not marked variable are used. Empty for fully random salts.
+			std::string strSaltVariable; // 32 bytes, non-zero where the salt is variable. Empty for fully random salts.
+			bool bCreate3; // Score keccak256(rlp([create2 address, 1]))[12:] instead of the CREATE2 address
+			std::vector<mode> vModes; // Every hash is scored by all modes, at most ERADICATE2_MAX_MODES
+			cl_uchar scoreMax; // Only results scoring above this are reported
+			std::vector<cl_uchar> vScoreMax; // Per mode scoreMax, e.g. the best score already known. Empty for scoreMax everywhere.
+			cl_uchar scoreTarget; // Stop once a result in any mode reaches this score, 0 runs until stop()
+
+			// Hashes scoring at least candidateScore in candidateMode are scored again on the host by every scorer. Their
+			// results are reported with mode index vModes.size() + scorer index.
+			std::vector<std::shared_ptr<HostScorer>> vScorers;
+			mode candidateMode;
+			cl_uchar candidateScore;
+
+			// Vary a field of the init code instead of the salt, e.g. constructor arguments. The init code digest is then
+			// computed per hash on the devices and strInitCodeDigest is unused. The last 12 bytes of the field hold the
+			// counter and the rest is randomized when the job starts. 0 size varies the salt as usual.
+			std::string strInitCode;
+			size_t initCodeVariableOffset;
+			size_t initCodeVariableSize;
+
+			// Safe ProxyFactory createProxyWithNonce: the CREATE2 salt is keccak256(keccak256(initializer) ++ saltNonce) and
+			// the search varies saltNonce, which is what results report as their salt. Empty for plain salts.
+			std::string strSafeInitializerDigest;
+
+			// Hard constraint, only addresses whose bits under the mask equal those of the value are scored. 20 bytes each,
+			// empty for none.
+			std::string strConstraintMask;
+			std::string strConstraintValue;
+
+			// Processes sharing a job use the same seed and disjoint device index ranges so they never hash the same salt,
+			// see SharedJob. A seed of 0 draws the random part of the salt from std::random_device.
+			cl_ulong seed;
+			cl_uint deviceIndexBase;
+
+			// Added to the round base drawn from the seed, a job started again skips the rounds() it already covered
+			cl_uint roundBase;
+		};
+
+		typedef Dispatcher::ResultCallback ResultCallback;
+		typedef Dispatcher::ProgressCallback ProgressCallback;
+		typedef Dispatcher::Histogram Histogram;
+
+	public:
+		SearchEngine(const Config & config);
+		~SearchEngine();
+
+		void init();
+		const std::vector<DeviceInfo> & devices() const;
+
+		void start(const Job & job, ResultCallback resultCallback, ProgressCallback progressCallback);
+		void stop();
+		void wait();
+		bool running();
+		void raiseScoreMax(const size_t modeIndex, const cl_uchar score);
+		Histogram histogram(const size_t deviceIndex);
+		std::map<size_t, double> benchmarkDispatch(const std::string & strDispatch, const unsigned int rounds);
+		void candidateStats(cl_ulong & scored, cl_ulong & dropped, size_t & backlog);
+		std::string initCode(const result & r) const; // Init code of a result of the running or last job
+		cl_uint rounds(); // Rounds of the running or last job, see Job::roundBase
+
+		static std::string keccakDigest(const std::string & data);
+		static std::string keccakDigest(std::istream & in, const bool bHex, std::string * const pData = NULL);
+		static job makeJob(const Job & j);
+		static std::string candidateSalt(const job & j, const candidate & c);
+		static std::string candidateAddress(const Job & j, const job & jobDevice, const candidate & c);
+		static std::vector<cl_ulong> initCodeTail(const Job & j);
+		static std::string initCodeVariant(const Job & j, const job & jobDevice, const candidate & c);
+		static std::string safeSalt(const std::string & strInitializerDigest, const std::string & strSaltNonce);
+		static std::string create2Address(const std::string & strAddressBinary, const std::string & strSalt, const std::string & strInitCodeDigest);
+		static std::string create3Address(const std::string & strProxyBinary);
+		static unsigned int gasSaved(const result & r, const bool bSalt);
+		static std::string keccakBuildOption(const std::string & strKeccak);
+		static Dispatcher::DispatchModel dispatchModel(const std::string & strDispatch);
+		static std::vector<cl_device_partition_property> partitionProperties(const std::string & strPartition);
+		static void parseSaltTemplate(const std::string & strTemplate, std::string & strSaltTemplate, std::string & strSaltVariable);
+		static void parseConstraint(const std::string & strConstraint, std::string & strMask, std::string & strValue);
+		static bool constraintPass(const Job & j, const std::string & strAddress);
+
+	private:
+		SearchEngine(SearchEngine & o);
+		SearchEngine & operator=(const SearchEngine & o);
+
+		std::ostream & log();
+		std::string readKernel(const std::string & strFilename) const;
+		std::string selfTest(const size_t deviceIndex);
+		std::vector<cl_device_id> partition(const DeviceInfo & info, const std::vector<cl_device_partition_property> & vProperties);
+		void deviceFailed(const size_t deviceIndex, const std::string & strProblem);
+		void deviceError(const size_t deviceIndex, const std::string & strProblem, const bool bRetry);
+		bool initPlatform(cl_platform_id clPlatformId, std::vector<cl_device_id> & vDevices, const std::string & strBuildOptions);
+		cl_program buildProgram(cl_context & clContext, std::vector<cl_device_id> & vDevices, const std::string & strBuildOptions, const std::string & strKeccak);
+		bool compileProgram(cl_program & clProgram, std::vector<cl_device_id> & vDevices, const std::string & strBuildOptions);
+
+	private:
+		const Config m_config;
+		std::ostream m_logNull;
+		bool m_bInitialized;
+
+		std::vector<DeviceInfo> m_vDevices;
+		std::vector<cl_device_id> m_vSubDevices;
+		std::vector<cl_context> m_vContexts;
+		std::vector<cl_program> m_vPrograms;
+		std::unique_ptr<Trace> m_pTrace;
+		Dispatcher m_dispatcher;
+		std::unique_ptr<ScorerPool> m_pScorerPool;
+		std::unique_ptr<ResultVerifier> m_pResultVerifier;
+		std::mutex m_mutexDevices;
+		Job m_jobRun;
+		job m_jobDevice;
+};
+
+#endif /* HPP_SEARCHENGINE */
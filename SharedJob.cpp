@@ -0,0 +1,214 @@
+#include "SharedJob.hpp"
+
+#include <stdexcept>
+#include <random>
+#include <atomic>
+#include <ctime>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "ModeFactory.hpp"
+#include "hexadecimal.hpp"
+#include "lexical_cast.hpp"
+
+// "ERADIC2S", written by the first process opening the segment
+#define ERADICATE2_SHARED_MAGIC 0x5332434944415245ULL
+
+// Seconds without a heartbeat after which a slot is free to be claimed again, e.g. after a crash
+#define ERADICATE2_SHARED_STALE 60
+
+// Device indexes per slot, the device index of a process is its slot times this plus its own index
+#define ERADICATE2_SHARED_DEVICES 65536
+
+// A freshly created segment is all zero, which is a valid empty state, so nobody has to initialize it. A slot is claimed
+// by a word holding the owner's random token in the upper half and the time of its last heartbeat in the lower half.
+struct SharedJob::Segment {
+	std::atomic<cl_ulong> magic;
+	std::atomic<cl_ulong> seed;
+	std::atomic<cl_uint> scoreBest[ERADICATE2_MAX_MODES];
+	std::atomic<cl_ulong> claim[ERADICATE2_SHARED_PROCESSES];
+	std::atomic<cl_ulong> speed[ERADICATE2_SHARED_PROCESSES]; // Hashes per second
+};
+
+static cl_ulong timeNow() {
+	return static_cast<cl_ulong>(std::time(NULL)) & 0xFFFFFFFFULL;
+}
+
+static bool claimLive(const cl_ulong claim, const cl_ulong now) {
+	return claim != 0 && static_cast<cl_uint>(now - (claim & 0xFFFFFFFFULL)) < ERADICATE2_SHARED_STALE;
+}
+
+SharedJob::SharedJob(const SearchEngine::Job & j) :
+	m_strName(name(j)),
+	m_pSegment(NULL),
+	m_slot(0),
+	m_owner(0),
+	m_seed(0)
+{
+#ifdef _WIN32
+	throw std::runtime_error("shared jobs require POSIX shared memory");
+#else
+	const int fd = shm_open(m_strName.c_str(), O_RDWR | O_CREAT, 0600);
+	struct stat st;
+	if (fd == -1 || fstat(fd, &st) != 0 || (static_cast<size_t>(st.st_size) < sizeof(Segment) && ftruncate(fd, sizeof(Segment)) != 0)) {
+		if (fd != -1) {
+			close(fd);
+		}
+
+		throw std::runtime_error("failed to open shared memory \"" + m_strName + "\"");
+	}
+
+	void * const pMap = mmap(NULL, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (pMap == MAP_FAILED) {
+		throw std::runtime_error("failed to map shared memory \"" + m_strName + "\"");
+	}
+
+	m_pSegment = static_cast<Segment *>(pMap);
+
+	cl_ulong magic = 0;
+	if (!m_pSegment->magic.compare_exchange_strong(magic, ERADICATE2_SHARED_MAGIC) && magic != ERADICATE2_SHARED_MAGIC) {
+		munmap(m_pSegment, sizeof(Segment));
+		throw std::runtime_error("shared memory \"" + m_strName + "\" doesn't belong to ERADICATE2");
+	}
+
+	try {
+		claim();
+	} catch (std::runtime_error &) {
+		munmap(m_pSegment, sizeof(Segment));
+		throw;
+	}
+#endif
+}
+
+SharedJob::~SharedJob() {
+#ifndef _WIN32
+	std::lock_guard<std::mutex> lock(m_mutex);
+	cl_ulong owner = m_owner;
+	if (m_pSegment->claim[m_slot].compare_exchange_strong(owner, 0)) {
+		m_pSegment->speed[m_slot].store(0);
+	}
+
+	// The last process out removes the segment, the next run starts afresh
+	const cl_ulong now = timeNow();
+	bool bAlone = true;
+	for (size_t i = 0; i < ERADICATE2_SHARED_PROCESSES; ++i) {
+		bAlone = bAlone && !claimLive(m_pSegment->claim[i].load(), now);
+	}
+
+	if (bAlone) {
+		shm_unlink(m_strName.c_str());
+	}
+
+	munmap(m_pSegment, sizeof(Segment));
+#endif
+}
+
+// Segment name derived from everything that makes two processes' results comparable
+std::string SharedJob::name(const SearchEngine::Job & j) {
+	std::string strPreimage = j.strAddressBinary + j.strInitCodeDigest + j.strInitCode;
+	strPreimage += lexical_cast::write(j.initCodeVariableOffset) + ":" + lexical_cast::write(j.initCodeVariableSize) + ":";
+	strPreimage += static_cast<char>(j.bCreate3);
+	strPreimage += j.strSaltTemplate + j.strSaltVariable;
+	strPreimage += j.strSafeInitializerDigest;
+	strPreimage += j.strConstraintMask + j.strConstraintValue;
+	for (auto & m : j.vModes) {
+		strPreimage += ModeFactory::key(m);
+	}
+
+	const std::string strDigest = SearchEngine::keccakDigest(strPreimage);
+	return "/eradicate2-" + toHex(reinterpret_cast<const uint8_t *>(strDigest.data()), 8);
+}
+
+cl_ulong SharedJob::seed() const {
+	return m_seed;
+}
+
+cl_uint SharedJob::deviceIndexBase() const {
+	return static_cast<cl_uint>(m_slot * ERADICATE2_SHARED_DEVICES);
+}
+
+void SharedJob::publish(const size_t modeIndex, const cl_uchar score) {
+	std::atomic<cl_uint> & best = m_pSegment->scoreBest[modeIndex];
+	cl_uint scoreBest = best.load();
+	while (score > scoreBest && !best.compare_exchange_weak(scoreBest, score)) {
+	}
+}
+
+cl_uchar SharedJob::best(const size_t modeIndex) const {
+	return static_cast<cl_uchar>(m_pSegment->scoreBest[modeIndex].load());
+}
+
+bool SharedJob::heartbeat(const double speed) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const cl_ulong owner = (m_owner & 0xFFFFFFFF00000000ULL) | timeNow();
+
+	// Fails only if this process stalled for longer than ERADICATE2_SHARED_STALE and another one took over the slot
+	cl_ulong ownerLast = m_owner;
+	if (!m_pSegment->claim[m_slot].compare_exchange_strong(ownerLast, owner)) {
+		return false;
+	}
+
+	m_owner = owner;
+	m_pSegment->speed[m_slot].store(static_cast<cl_ulong>(speed));
+	return true;
+}
+
+double SharedJob::speedTotal(size_t & processes) const {
+	const cl_ulong now = timeNow();
+	double speed = 0;
+	processes = 0;
+
+	for (size_t i = 0; i < ERADICATE2_SHARED_PROCESSES; ++i) {
+		if (claimLive(m_pSegment->claim[i].load(), now)) {
+			speed += static_cast<double>(m_pSegment->speed[i].load());
+			++processes;
+		}
+	}
+
+	return speed;
+}
+
+// Takes the first free or stale slot. The first process of a run, finding no other live slot, draws a new seed so salts
+// hashed by an earlier run whose segment was left behind aren't hashed again.
+void SharedJob::claim() {
+	std::random_device rd;
+	const cl_ulong token = static_cast<cl_ulong>(rd() | 1U) << 32;
+	const cl_ulong now = timeNow();
+
+	for (size_t i = 0; i < ERADICATE2_SHARED_PROCESSES && m_owner == 0; ++i) {
+		cl_ulong claim = m_pSegment->claim[i].load();
+		if (!claimLive(claim, now) && m_pSegment->claim[i].compare_exchange_strong(claim, token | now)) {
+			m_slot = i;
+			m_owner = token | now;
+		}
+	}
+
+	if (m_owner == 0) {
+		throw std::runtime_error("all " + lexical_cast::write(ERADICATE2_SHARED_PROCESSES) + " processes of shared job \"" + m_strName + "\" are taken");
+	}
+
+	bool bAlone = true;
+	for (size_t i = 0; i < ERADICATE2_SHARED_PROCESSES; ++i) {
+		bAlone = bAlone && (i == m_slot || !claimLive(m_pSegment->claim[i].load(), now));
+	}
+
+	cl_ulong seed = m_pSegment->seed.load();
+	if (bAlone || seed == 0) {
+		const cl_ulong seedNew = ((static_cast<cl_ulong>(rd()) << 32) | rd()) | 1;
+		if (m_pSegment->seed.compare_exchange_strong(seed, seedNew)) {
+			seed = seedNew;
+			for (size_t k = 0; k < ERADICATE2_MAX_MODES; ++k) {
+				m_pSegment->scoreBest[k].store(0);
+			}
+		}
+	}
+
+	m_seed = seed;
+	m_pSegment->speed[m_slot].store(0);
+}
@@ -0,0 +1,54 @@
+#ifndef HPP_SHAREDJOB
+#define HPP_SHAREDJOB
+
+#include <string>
+#include <mutex>
+
+#include "SearchEngine.hpp"
+#include "types.hpp"
+
+// Processes that can share a job at the same time
+#define ERADICATE2_SHARED_PROCESSES 64
+
+/* Coordinates processes on one host running the same job, e.g. one per GPU, through a POSIX shared memory segment named
+ * after the job. Each process claims a slot that gives it a disjoint range of device indexes, and all of them hash with
+ * the same seed, so no two of them ever try the same salt. The best score of every mode and the speed of every process
+ * are published in the segment. A process only reports results beating the best of all of them and sees the combined
+ * speed. Everything in the segment is an atomic, there are no locks a crashed process could leave held.
+ */
+class SharedJob {
+	public:
+		SharedJob(const SearchEngine::Job & j);
+		~SharedJob();
+
+		static std::string name(const SearchEngine::Job & j);
+
+		cl_ulong seed() const;
+		cl_uint deviceIndexBase() const;
+
+		void publish(const size_t modeIndex, const cl_uchar score);
+		cl_uchar best(const size_t modeIndex) const;
+
+		// Publishes the speed of this process and keeps its slot alive, must be called at least every few seconds. False
+		// once the slot has been taken over by another process, this one must stop searching.
+		bool heartbeat(const double speed);
+		double speedTotal(size_t & processes) const;
+
+	private:
+		SharedJob(SharedJob & o);
+		SharedJob & operator=(const SharedJob & o);
+
+		void claim();
+
+	private:
+		struct Segment;
+
+		const std::string m_strName;
+		Segment * m_pSegment;
+		size_t m_slot;
+		cl_ulong m_owner; // Claim word last written to the slot, the owner token in the upper half and the time in the lower
+		cl_ulong m_seed;
+		std::mutex m_mutex;
+};
+
+#endif /* HPP_SHAREDJOB */
@@ -29,7 +29,8 @@ Speed::Speed(const unsigned int intervalPrintMs, const unsigned int intervalSamp
 Speed::~Speed() {
 }
 
-void Speed::update(const unsigned int numPoints, const unsigned int indexDevice) {
+// Returns true when the print interval has passed, the caller decides how to present it
+bool Speed::update(const unsigned int numPoints, const unsigned int indexDevice) {
 	std::lock_guard<std::recursive_mutex> lockGuard(m_mutex);
 
 	const auto ns = std::chrono::steady_clock::now().time_since_epoch().count();
@@ -40,8 +41,22 @@ void Speed::update(const unsigned int numPoints, const unsigned int indexDevice)
 
 	if (bPrint) {
 		m_lastPrint = ns;
-		this->print();
 	}
+
+	return bPrint;
+}
+
+void Speed::clear() {
+	std::lock_guard<std::recursive_mutex> lockGuard(m_mutex);
+	m_lastPrint = 0;
+	m_lSamples.clear();
+	m_mDeviceSamples.clear();
+}
+
+// Drops a device that stopped, e.g. after failing, so it no longer shows with its last speed
+void Speed::remove(const unsigned int indexDevice) {
+	std::lock_guard<std::recursive_mutex> lockGuard(m_mutex);
+	m_mDeviceSamples.erase(indexDevice);
 }
 
 double Speed::getSpeed() const {
@@ -76,7 +91,7 @@ void Speed::updateList(const unsigned int & numPoints, const long long & ns, sam
 	}
 }
 
-void Speed::print() const {
+void Speed::print(const std::string & strStatus) const {
 	const std::string strVT100ClearLine = "\33[2K\r";
 	std::cout << strVT100ClearLine << "Speed: " << formatSpeed(this->getSpeed());
 	
@@ -85,5 +100,5 @@ void Speed::print() const {
 		std::cout << " GPU" << it->first << ": " << formatSpeed(this->getSpeed(it->second));
 	}
 
-	std::cout << "\r" << std::flush;
+	std::cout << strStatus << "\r" << std::flush;
 }
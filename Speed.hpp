@@ -5,6 +5,7 @@
 #include <mutex>
 #include <list>
 #include <map>
+#include <string>
 
 class Speed {
 public:
@@ -15,8 +16,10 @@ public:
 	Speed(const unsigned int intervalPrintMs = 500, const unsigned int intervalSampleMs = 10000);
 	~Speed();
 
-	void update(const unsigned int numPoints, const unsigned int indexDevice);
-	void print() const;
+	bool update(const unsigned int numPoints, const unsigned int indexDevice);
+	void print(const std::string & strStatus = "") const;
+	void clear();
+	void remove(const unsigned int indexDevice);
 
 	double getSpeed() const;
 	double getSpeed(const unsigned int indexDevice) const;
@@ -0,0 +1,91 @@
+#include "Trace.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <set>
+
+// Spans kept, 32 MiB
+#define ERADICATE2_TRACE_SPANS (1024 * 1024)
+
+static const char * const g_szLaneNames[] = { "host", "queue" };
+
+Trace::Trace() :
+	m_start(now()),
+	m_vSpans(ERADICATE2_TRACE_SPANS),
+	m_count(0)
+{
+
+}
+
+long long Trace::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::span(const char * const szName, const unsigned int device, const Lane lane, const long long begin, const long long end) {
+	const size_t index = m_count.fetch_add(1, std::memory_order_relaxed);
+	if (index < m_vSpans.size()) {
+		Span & s = m_vSpans[index];
+		s.szName = szName;
+		s.device = device;
+		s.lane = lane;
+		s.begin = begin;
+		s.end = std::max(begin, end);
+	}
+}
+
+Trace::Scope::Scope(Trace * const pTrace, const char * const szName, const unsigned int device) :
+	m_pTrace(pTrace),
+	m_szName(szName),
+	m_device(device),
+	m_begin(pTrace == NULL ? 0 : now())
+{
+
+}
+
+Trace::Scope::~Scope() {
+	if (m_pTrace != NULL) {
+		m_pTrace->span(m_szName, m_device, Host, m_begin, now());
+	}
+}
+
+void Trace::write(const std::string & strFilename) const {
+	std::ofstream ofs(strFilename, std::ios::out | std::ios::trunc);
+	if (!ofs.is_open()) {
+		throw std::runtime_error("failed to open trace file \"" + strFilename + "\"");
+	}
+
+	const size_t count = std::min(m_count.load(), m_vSpans.size());
+	std::set<unsigned int> sDevices;
+	for (size_t i = 0; i < count; ++i) {
+		sDevices.insert(m_vSpans[i].device);
+	}
+
+	// Names of the devices and their lanes, then the spans with timestamps in microseconds since the trace started
+	ofs << "{\"traceEvents\":[" << std::endl;
+	const char * szSeparator = "";
+	for (auto device : sDevices) {
+		ofs << szSeparator << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << device << ",\"args\":{\"name\":\"GPU" << device << "\"}}";
+		szSeparator = ",\n";
+
+		for (unsigned int lane = 0; lane < sizeof(g_szLaneNames) / sizeof(g_szLaneNames[0]); ++lane) {
+			ofs << szSeparator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << device << ",\"tid\":" << lane << ",\"args\":{\"name\":\"" << g_szLaneNames[lane] << "\"}}";
+		}
+	}
+
+	ofs << std::fixed << std::setprecision(3);
+	for (size_t i = 0; i < count; ++i) {
+		const Span & s = m_vSpans[i];
+		ofs << szSeparator << "{\"name\":\"" << s.szName << "\",\"ph\":\"X\",\"pid\":" << s.device << ",\"tid\":" << s.lane;
+		ofs << ",\"ts\":" << (s.begin - m_start) / 1000.0 << ",\"dur\":" << (s.end - s.begin) / 1000.0 << "}";
+		szSeparator = ",\n";
+	}
+
+	ofs << std::endl << "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedSpans\":\"" << (m_count.load() - count) << "\"}}" << std::endl;
+
+	if (!ofs) {
+		throw std::runtime_error("failed to write trace file \"" + strFilename + "\"");
+	}
+}
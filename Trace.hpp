@@ -0,0 +1,63 @@
+#ifndef HPP_TRACE
+#define HPP_TRACE
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+/* Timeline of what the devices and the dispatch threads spend their time on, written in the Chrome trace format that
+ * chrome://tracing and Perfetto open. Spans are recorded into a fixed buffer by claiming a slot with a single atomic
+ * increment, once it's full further spans are counted as dropped. The buffer is only read by write() after the run.
+ *
+ * Every device is a process of the trace with a host thread, the dispatch of its rounds, and a queue thread with the
+ * kernels and transfers as timed by OpenCL profiling.
+ */
+class Trace {
+	public:
+		enum Lane {
+			Host = 0,
+			Queue = 1
+		};
+
+	private:
+		struct Span {
+			const char * szName; // String literal
+			unsigned int device;
+			Lane lane;
+			long long begin; // Nanoseconds of now()
+			long long end;
+		};
+
+	public:
+		// Records the host time until it goes out of scope, does nothing without a trace
+		class Scope {
+			public:
+				Scope(Trace * const pTrace, const char * const szName, const unsigned int device);
+				~Scope();
+
+			private:
+				Trace * const m_pTrace;
+				const char * const m_szName;
+				const unsigned int m_device;
+				const long long m_begin;
+		};
+
+	public:
+		Trace();
+
+		static long long now();
+
+		void span(const char * const szName, const unsigned int device, const Lane lane, const long long begin, const long long end);
+		void write(const std::string & strFilename) const;
+
+	private:
+		Trace(Trace & o);
+		Trace & operator=(const Trace & o);
+
+	private:
+		const long long m_start;
+		std::vector<Span> m_vSpans;
+		std::atomic<size_t> m_count;
+};
+
+#endif /* HPP_TRACE */
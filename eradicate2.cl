@@ -1,5 +1,5 @@
 enum ModeFunction {
-	Benchmark, ZeroBytes, Matching, Leading, Range, Mirror, Doubles, LeadingRange
+	Benchmark, ZeroBytes, Matching, Leading, Range, Mirror, Doubles, LeadingRange, Gas
 };
 
 typedef struct {
@@ -8,160 +8,439 @@ typedef struct {
 	uchar data2[20];
 } mode;
 
+typedef struct {
+	ethhash init;
+	ethhash initCodeMidstate;
+	ethhash safeSalt;
+	ulong constraintMask[3];
+	ulong constraintValue[3];
+	uint saltOffset;
+	uint create3;
+	uint modeCount;
+	uint candidateScore;
+	uint candidateMax;
+	uint initCodeBlocks;
+	uint initCodeCounterOffset;
+	uint safe;
+	uint saltZeroBytes; // Zero bytes of the salt outside of the counter
+	uint roundBase; // Added to the round in the counter, results report the round alone
+} job;
+
+typedef struct {
+	uint deviceIndex;
+	uint id;
+	uint round;
+} candidate;
+
 typedef struct __attribute__((packed)) {
 	uchar salt[32];
 	uchar hash[20];
+	uint deviceIndex;
+	uint id;
+	uint round;
 	uint found;
 } result;
 
-__kernel void eradicate2_iterate(__global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round);
-void eradicate2_result_update(const uchar * const hash, __global result * const pResult, const uchar score, const uchar scoreMax, const uint deviceIndex, const uint round);
-void eradicate2_score_leading(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round);
-void eradicate2_score_benchmark(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round);
-void eradicate2_score_zerobytes(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round);
-void eradicate2_score_matching(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round);
-void eradicate2_score_range(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round);
-void eradicate2_score_leadingrange(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round);
-void eradicate2_score_mirror(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round);
-void eradicate2_score_doubles(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round);
-
-__kernel void eradicate2_iterate(__global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round) {
-	ethhash h = { .q = { ERADICATE2_INITHASH } };
-
-	// Salt have index h.b[21:52] inclusive, which covers WORDS with index h.d[6:12] inclusive (they represent h.b[24:51] inclusive)
-	// We use three out of those six words to generate a unique salt value for each device, thread and round. We ignore any overflows
-	// and assume that there'll never be more than 2**32 devices, threads or rounds. Worst case scenario with default settings
-	// of 16777216 = 2**24 threads means the assumption fails after a device has tried 2**32 * 2**24 = 2**56 salts, enough to match
-	// 14 characters in the address! A GTX 1070 with speed of ~700*10**6 combinations per second would hit this target after ~3 years.
-	h.d[6] += deviceIndex; 
-	h.d[7] += get_global_id(0);
-	h.d[8] += round;
+uchar eradicate2_address_byte(const ulong q1, const ulong q2, const ulong q3, const int i);
+uint eradicate2_zero_bytes(const ulong x);
+uint eradicate2_ctz(const ulong x);
+void eradicate2_salt_apply(ulong * const st, __constant job * const pJob, const uint deviceIndex, const uint round);
+void eradicate2_init_code_hash(ulong * const st, __constant job * const pJob, __global const ulong * const pInitCode, const uint deviceIndex, const uint round);
+__kernel void eradicate2_iterate(__global result * const pResult, __global const mode * const pMode, __constant job * const pJob, const ulong scoreMax, const uint deviceIndex, const uint round, __global uint * const pHistogram, __global uint * const pCandidateCount, __global candidate * const pCandidates, __global const ulong * const pInitCode);
+__kernel void eradicate2_noop();
+void eradicate2_result_update(const ulong q1, const ulong q2, const ulong q3, __global result * const pResult, __constant job * const pJob, const uchar score, const uchar scoreMax, const uint deviceIndex, const uint round);
+uchar eradicate2_score(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, __constant job * const pJob, const uint deviceIndex, const uint round);
+uchar eradicate2_score_leading(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round);
+uchar eradicate2_score_benchmark(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round);
+uchar eradicate2_score_zerobytes(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round);
+uchar eradicate2_score_matching(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round);
+uchar eradicate2_score_range(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round);
+uchar eradicate2_score_leadingrange(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round);
+uchar eradicate2_score_mirror(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round);
+uchar eradicate2_score_doubles(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round);
+uchar eradicate2_score_gas(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, __constant job * const pJob, const uint deviceIndex, const uint round);
+
+__kernel void eradicate2_iterate(__global result * const pResult, __global const mode * const pMode, __constant job * const pJob, const ulong scoreMax, const uint deviceIndex, const uint round, __global uint * const pHistogram, __global uint * const pCandidateCount, __global candidate * const pCandidates, __global const ulong * const pInitCode) {
+#ifdef ERADICATE2_HISTOGRAM
+	// Every score of every mode is counted in a work-group histogram that is flushed with one atomic per non-empty bin.
+	// The host keeps running totals to validate the score distribution and the number of hashes actually computed.
+	__local uint histogram[(ERADICATE2_MAX_SCORE + 1) * ERADICATE2_MAX_MODES];
+	for (uint i = get_local_id(0); i < (ERADICATE2_MAX_SCORE + 1) * pJob->modeCount; i += get_local_size(0)) {
+		histogram[i] = 0;
+	}
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+#endif
+
+	// The state is only ever indexed with constants so it stays in registers, byte access to an ethhash would force it to
+	// private memory
+	ulong st[25];
+
+	if (pJob->initCodeBlocks) {
+		// The counter varies the init code instead of the salt, its digest h.b[53:85] straddles lanes 6 to 10
+		eradicate2_init_code_hash(st, pJob, pInitCode, deviceIndex, round);
+		const ulong d0 = st[0];
+		const ulong d1 = st[1];
+		const ulong d2 = st[2];
+		const ulong d3 = st[3];
+
+		#pragma unroll
+		for (int i = 0; i < 25; ++i) {
+			st[i] = pJob->init.q[i];
+		}
+
+		st[6] ^= d0 << 40;
+		st[7] ^= (d0 >> 24) | (d1 << 40);
+		st[8] ^= (d1 >> 24) | (d2 << 40);
+		st[9] ^= (d2 >> 24) | (d3 << 40);
+		st[10] ^= d3 >> 24;
+	} else if (pJob->safe) {
+		// Safe ProxyFactory: the counter varies saltNonce and the salt is keccak256(keccak256(initializer) ++ saltNonce),
+		// one extra permutation per hash. The salt h.b[21:53] straddles lanes 2 to 6.
+		#pragma unroll
+		for (int i = 0; i < 25; ++i) {
+			st[i] = pJob->safeSalt.q[i];
+		}
+
+		eradicate2_salt_apply(st, pJob, deviceIndex, round);
+		st[16] ^= 0x8000000000000000UL;
+		keccakf(st);
+		const ulong s0 = st[0];
+		const ulong s1 = st[1];
+		const ulong s2 = st[2];
+		const ulong s3 = st[3];
+
+		#pragma unroll
+		for (int i = 0; i < 25; ++i) {
+			st[i] = pJob->init.q[i];
+		}
+
+		st[2] ^= s0 << 40;
+		st[3] ^= (s0 >> 24) | (s1 << 40);
+		st[4] ^= (s1 >> 24) | (s2 << 40);
+		st[5] ^= (s2 >> 24) | (s3 << 40);
+		st[6] ^= s3 >> 24;
+	} else {
+		#pragma unroll
+		for (int i = 0; i < 25; ++i) {
+			st[i] = pJob->init.q[i];
+		}
+
+		eradicate2_salt_apply(st, pJob, deviceIndex, round);
+	}
 
 	// Hash
-	sha3_keccakf(&h);
+	st[16] ^= 0x8000000000000000UL;
+	keccakf(st);
+
+	if (pJob->create3) {
+		// CREATE3: the CREATE2 address is a proxy that deploys the contract with CREATE at nonce 1, the final address is
+		// keccak256(rlp([proxy, 1]))[12:]. The RLP encoding 0xd6 0x94 <proxy> 0x01 is 23 bytes, always a single block.
+		const ulong p0 = 0x94d6UL | ((st[1] >> 32) << 16) | (st[2] << 48);
+		const ulong p1 = (st[2] >> 16) | (st[3] << 48);
+		const ulong p2 = (st[3] >> 16) | 0x0101000000000000UL;
+
+		#pragma unroll
+		for (int i = 0; i < 25; ++i) {
+			st[i] = 0;
+		}
+
+		st[0] = p0;
+		st[1] = p1;
+		st[2] = p2;
+		st[16] = 0x8000000000000000UL;
+		keccakf(st);
+	}
+
+	// Address is h.b[12:32], the upper half of lane 1 followed by lanes 2 and 3
+	const ulong q1 = st[1];
+	const ulong q2 = st[2];
+	const ulong q3 = st[3];
+
+	// Hard constraint on address bits, e.g. the permission flags of a Uniswap v4 hook. Hashes failing it score 0 in every mode
+	// and nearly all of them fail, so whole work-groups skip the scorers. Without a constraint the mask is zero.
+	const bool bPass = (((q1 ^ pJob->constraintValue[0]) & pJob->constraintMask[0]) | ((q2 ^ pJob->constraintValue[1]) & pJob->constraintMask[1]) | ((q3 ^ pJob->constraintValue[2]) & pJob->constraintMask[2])) == 0;
+
+	// Every mode scores the same hash into its own result table. The best score found so far for mode k is byte k of
+	// scoreMax.
+	for (uint k = 0; k < pJob->modeCount; ++k) {
+		__global result * const pModeResult = pResult + k * (ERADICATE2_MAX_SCORE + 1);
+		__global const mode * const pModeK = pMode + k;
+
+		const uchar score = bPass ? eradicate2_score(q1, q2, q3, pModeK, pJob, deviceIndex, round) : 0;
+		eradicate2_result_update(q1, q2, q3, pModeResult, pJob, score, (uchar) (scoreMax >> (8 * k)), deviceIndex, round);
+
+#ifdef ERADICATE2_HISTOGRAM
+		atomic_inc(&histogram[k * (ERADICATE2_MAX_SCORE + 1) + score]);
+#endif
+	}
+
+	// Hashes passing the prefilter, the mode following the searched ones, are appended for host side scoring. The count
+	// keeps increasing past the end of the buffer so the host can tell how many were dropped.
+	if (pJob->candidateScore && bPass && eradicate2_score(q1, q2, q3, pMode + pJob->modeCount, pJob, deviceIndex, round) >= pJob->candidateScore) {
+		const uint i = atomic_inc(pCandidateCount);
+		if (i < pJob->candidateMax) {
+			pCandidates[i].deviceIndex = deviceIndex;
+			pCandidates[i].id = get_global_id(0);
+			pCandidates[i].round = round;
+		}
+	}
+
+#ifdef ERADICATE2_HISTOGRAM
+	barrier(CLK_LOCAL_MEM_FENCE);
+	for (uint i = get_local_id(0); i < (ERADICATE2_MAX_SCORE + 1) * pJob->modeCount; i += get_local_size(0)) {
+		if (histogram[i]) {
+			atomic_add(&pHistogram[i], histogram[i]);
+		}
+	}
+#endif
+}
+
+// Does nothing, used to measure the host round trip of a dispatch without any device work
+__kernel void eradicate2_noop() {
+}
+
+// Byte i of the address. Scorers unroll their loops so i is a constant and this folds into a single shift.
+uchar eradicate2_address_byte(const ulong q1, const ulong q2, const ulong q3, const int i) {
+	if (i < 4) {
+		return (uchar) (q1 >> (32 + 8 * i));
+	} else if (i < 12) {
+		return (uchar) (q2 >> (8 * (i - 4)));
+	}
+
+	return (uchar) (q3 >> (8 * (i - 12)));
+}
+
+// Number of zero bytes in a lane, the high bit of t is set in exactly the bytes of x that are zero
+uint eradicate2_zero_bytes(const ulong x) {
+	const ulong t = (x & 0x7F7F7F7F7F7F7F7FUL) + 0x7F7F7F7F7F7F7F7FUL;
+	return popcount(~(t | x | 0x7F7F7F7F7F7F7F7FUL));
+}
+
+// Trailing zero bits, 64 for zero. ctz() itself requires OpenCL 2.0.
+uint eradicate2_ctz(const ulong x) {
+	return popcount((x & (~x + 1)) - 1);
+}
+
+// Salt have index h.b[21:52] inclusive, which covers LANES with index h.q[2:6] inclusive. The 12 bytes starting at h.b[saltOffset]
+// lie within the variable part of the salt template and receive a unique value for each device, thread and round. The host has
+// already filled the rest of the variable part with random data and the fixed part with the template. We assume that there'll
+// never be more than 2**32 devices, threads or rounds. Worst case scenario with default settings of 16777216 = 2**24 threads means
+// the assumption fails after a device has tried 2**32 * 2**24 = 2**56 salts, enough to match 14 characters in the address! A GTX
+// 1070 with speed of ~700*10**6 combinations per second would hit this target after ~3 years.
+// Safe jobs apply the counter to the saltNonce of the salt preimage instead, saltOffset then points into safeSalt.b[32:64].
+// The round is offset by roundBase, drawn from the job seed, so salts of a job started again don't repeat even without random bytes.
+void eradicate2_salt_apply(ulong * const st, __constant job * const pJob, const uint deviceIndex, const uint round) {
+	// 96 bit counter XORed into the state, XOR keeps carries from spilling into fixed salt bytes
+	const ulong lo = deviceIndex | ((ulong) get_global_id(0) << 32);
+	const ulong hi = round + pJob->roundBase;
+	const uint lane = pJob->saltOffset / 8;
+	const uint shift = (pJob->saltOffset % 8) * 8;
+
+	// All work items take the same branches so selecting lanes at runtime costs next to nothing
+	#pragma unroll
+	for (uint i = 2; i <= 6; ++i) {
+		if (i == lane) {
+			st[i] ^= lo << shift;
+		} else if (i == lane + 1) {
+			st[i] ^= (shift ? lo >> (64 - shift) : 0) | (hi << shift);
+		} else if (i == lane + 2) {
+			st[i] ^= shift ? hi >> (64 - shift) : 0;
+		}
+	}
+}
+
+// Keccak-256 of the init code with the counter XORed in at byte initCodeCounterOffset of the blocks following the midstate.
+// The constant blocks before the counter are absorbed once on the host so only the remaining ones cost anything here.
+// pInitCode holds those blocks already padded.
+void eradicate2_init_code_hash(ulong * const st, __constant job * const pJob, __global const ulong * const pInitCode, const uint deviceIndex, const uint round) {
+	const ulong lo = deviceIndex | ((ulong) get_global_id(0) << 32);
+	const ulong hi = round + pJob->roundBase;
+	const uint lane = pJob->initCodeCounterOffset / 8;
+	const uint shift = (pJob->initCodeCounterOffset % 8) * 8;
+
+	#pragma unroll
+	for (int i = 0; i < 25; ++i) {
+		st[i] = pJob->initCodeMidstate.q[i];
+	}
+
+	for (uint b = 0; b < pJob->initCodeBlocks; ++b) {
+		#pragma unroll
+		for (uint i = 0; i < 17; ++i) {
+			const uint k = b * 17 + i;
+			ulong v = pInitCode[k];
+
+			if (k == lane) {
+				v ^= lo << shift;
+			} else if (k == lane + 1) {
+				v ^= (shift ? lo >> (64 - shift) : 0) | (hi << shift);
+			} else if (k == lane + 2) {
+				v ^= shift ? hi >> (64 - shift) : 0;
+			}
+
+			st[i] ^= v;
+		}
+
+		keccakf(st);
+	}
+}
+
+void eradicate2_result_update(const ulong q1, const ulong q2, const ulong q3, __global result * const pResult, __constant job * const pJob, const uchar score, const uchar scoreMax, const uint deviceIndex, const uint round) {
+	if (score && score > scoreMax) {
+		const uchar hasResult = atomic_inc(&pResult[score].found); // NOTE: If "too many" results are found it'll wrap around to 0 again and overwrite last result. Only relevant if global worksize exceeds MAX(uint).
+
+		// Save only one result for each score, the first.
+		if (hasResult == 0) {
+			// Reconstruct state and extract salt from h.b[21:53], for Safe jobs the saltNonce from the salt preimage at [32:64]
+			ulong st[25];
+			#pragma unroll
+			for (int i = 0; i < 25; ++i) {
+				st[i] = pJob->safe ? pJob->safeSalt.q[i] : pJob->init.q[i];
+			}
+
+			if (!pJob->initCodeBlocks) {
+				eradicate2_salt_apply(st, pJob, deviceIndex, round);
+			}
+
+			// Constant indexes keep st in registers, the offset picked at runtime would index it dynamically
+			if (pJob->safe) {
+				#pragma unroll
+				for (int i = 0; i < 32; ++i) {
+					pResult[score].salt[i] = (uchar) (st[(i + 32) / 8] >> (8 * ((i + 32) % 8)));
+				}
+			} else {
+				#pragma unroll
+				for (int i = 0; i < 32; ++i) {
+					pResult[score].salt[i] = (uchar) (st[(i + 21) / 8] >> (8 * ((i + 21) % 8)));
+				}
+			}
+
+			// The host rebuilds varied init code from the counter
+			pResult[score].deviceIndex = deviceIndex;
+			pResult[score].id = get_global_id(0);
+			pResult[score].round = round;
+
+			#pragma unroll
+			for (int i = 0; i < 20; ++i) {
+				pResult[score].hash[i] = eradicate2_address_byte(q1, q2, q3, i);
+			}
+		}
+	}
+}
+
+uchar eradicate2_score(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, __constant job * const pJob, const uint deviceIndex, const uint round) {
+	uchar score = 0;
 
 	/* enum class ModeFunction {
-	 *      Benchmark, ZeroBytes, Matching, Leading, Range, Mirror, Doubles, LeadingRange
+	 *      Benchmark, ZeroBytes, Matching, Leading, Range, Mirror, Doubles, LeadingRange, Gas
 	 * };
 	 */
 	switch (pMode->function) {
 	case Benchmark:
-		eradicate2_score_benchmark(h.b + 12, pResult, pMode, scoreMax, deviceIndex, round);
+		score = eradicate2_score_benchmark(q1, q2, q3, pMode, deviceIndex, round);
 		break;
 
 	case ZeroBytes:
-		eradicate2_score_zerobytes(h.b + 12, pResult, pMode, scoreMax, deviceIndex, round);
+		score = eradicate2_score_zerobytes(q1, q2, q3, pMode, deviceIndex, round);
 		break;
 
 	case Matching:
-		eradicate2_score_matching(h.b + 12, pResult, pMode, scoreMax, deviceIndex, round);
+		score = eradicate2_score_matching(q1, q2, q3, pMode, deviceIndex, round);
 		break;
 
 	case Leading:
-		eradicate2_score_leading(h.b + 12, pResult, pMode, scoreMax, deviceIndex, round);
+		score = eradicate2_score_leading(q1, q2, q3, pMode, deviceIndex, round);
 		break;
 
 	case Range:
-		eradicate2_score_range(h.b + 12, pResult, pMode, scoreMax, deviceIndex, round);
+		score = eradicate2_score_range(q1, q2, q3, pMode, deviceIndex, round);
 		break;
 
 	case Mirror:
-		eradicate2_score_mirror(h.b + 12, pResult, pMode, scoreMax, deviceIndex, round);
+		score = eradicate2_score_mirror(q1, q2, q3, pMode, deviceIndex, round);
 		break;
 
 	case Doubles:
-		eradicate2_score_doubles(h.b + 12, pResult, pMode, scoreMax, deviceIndex, round);
+		score = eradicate2_score_doubles(q1, q2, q3, pMode, deviceIndex, round);
 		break;
 
 	case LeadingRange:
-		eradicate2_score_leadingrange(h.b + 12, pResult, pMode, scoreMax, deviceIndex, round);
+		score = eradicate2_score_leadingrange(q1, q2, q3, pMode, deviceIndex, round);
 		break;
-	}
-}
-
-void eradicate2_result_update(const uchar * const H, __global result * const pResult, const uchar score, const uchar scoreMax, const uint deviceIndex, const uint round) {
-	if (score && score > scoreMax) {
-		const uchar hasResult = atomic_inc(&pResult[score].found); // NOTE: If "too many" results are found it'll wrap around to 0 again and overwrite last result. Only relevant if global worksize exceeds MAX(uint).
-
-		// Save only one result for each score, the first.
-		if (hasResult == 0) {
-			// Reconstruct state with hash and extract salt
-			ethhash h = { .q = { ERADICATE2_INITHASH } };
-			h.d[6] += deviceIndex;
-			h.d[7] += get_global_id(0);
-			h.d[8] += round;
 
-			ethhash be;
-
-			for (int i = 0; i < 32; ++i) {
-				pResult[score].salt[i] = h.b[i + 21];
-			}
-
-			for (int i = 0; i < 20; ++i) {
-				pResult[score].hash[i] = H[i];
-			}
-		}
+	case Gas:
+		score = eradicate2_score_gas(q1, q2, q3, pMode, pJob, deviceIndex, round);
+		break;
 	}
+
+	return score;
 }
 
-void eradicate2_score_leading(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round) {
+uchar eradicate2_score_leading(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round) {
 	int score = 0;
 
+	#pragma unroll
 	for (int i = 0; i < 20; ++i) {
-		if ((hash[i] & 0xF0) >> 4 == pMode->data1[0]) {
+		const uchar b = eradicate2_address_byte(q1, q2, q3, i);
+
+		if ((b & 0xF0) >> 4 == pMode->data1[0]) {
 			++score;
 		} else {
 			break;
 		}
 
-		if ((hash[i] & 0x0F) == pMode->data1[0]) {
+		if ((b & 0x0F) == pMode->data1[0]) {
 			++score;
 		} else {
 			break;
 		}
 	}
 
-	eradicate2_result_update(hash, pResult, score, scoreMax, deviceIndex, round);
+	return score;
 }
 
-void eradicate2_score_benchmark(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round) {
+uchar eradicate2_score_benchmark(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round) {
 	const size_t id = get_global_id(0);
 	int score = 0;
 
-	eradicate2_result_update(hash, pResult, score, scoreMax, deviceIndex, round);
+	return score;
 }
 
-void eradicate2_score_zerobytes(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round) {
+uchar eradicate2_score_zerobytes(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round) {
 	const size_t id = get_global_id(0);
 	int score = 0;
 
+	#pragma unroll
 	for (int i = 0; i < 20; ++i) {
-		score += !hash[i];
+		score += !eradicate2_address_byte(q1, q2, q3, i);
 	}
 
-	eradicate2_result_update(hash, pResult, score, scoreMax, deviceIndex, round);
+	return score;
 }
 
-void eradicate2_score_matching(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round) {
+uchar eradicate2_score_matching(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round) {
 	const size_t id = get_global_id(0);
 	int score = 0;
 
+	#pragma unroll
 	for (int i = 0; i < 20; ++i) {
-		if (pMode->data1[i] > 0 && (hash[i] & pMode->data1[i]) == pMode->data2[i]) {
+		if (pMode->data1[i] > 0 && (eradicate2_address_byte(q1, q2, q3, i) & pMode->data1[i]) == pMode->data2[i]) {
 			++score;
 		}
 	}
 
-	eradicate2_result_update(hash, pResult, score, scoreMax, deviceIndex, round);
+	return score;
 }
 
-void eradicate2_score_range(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round) {
+uchar eradicate2_score_range(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round) {
 	const size_t id = get_global_id(0);
 	int score = 0;
 
+	#pragma unroll
 	for (int i = 0; i < 20; ++i) {
-		const uchar first = (hash[i] & 0xF0) >> 4;
-		const uchar second = (hash[i] & 0x0F);
+		const uchar b = eradicate2_address_byte(q1, q2, q3, i);
+		const uchar first = (b & 0xF0) >> 4;
+		const uchar second = (b & 0x0F);
 
 		if (first >= pMode->data1[0] && first <= pMode->data2[0]) {
 			++score;
@@ -172,16 +451,18 @@ void eradicate2_score_range(const uchar * const hash, __global result * const pR
 		}
 	}
 
-	eradicate2_result_update(hash, pResult, score, scoreMax, deviceIndex, round);
+	return score;
 }
 
-void eradicate2_score_leadingrange(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round) {
+uchar eradicate2_score_leadingrange(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round) {
 	const size_t id = get_global_id(0);
 	int score = 0;
 
+	#pragma unroll
 	for (int i = 0; i < 20; ++i) {
-		const uchar first = (hash[i] & 0xF0) >> 4;
-		const uchar second = (hash[i] & 0x0F);
+		const uchar b = eradicate2_address_byte(q1, q2, q3, i);
+		const uchar first = (b & 0xF0) >> 4;
+		const uchar second = (b & 0x0F);
 
 		if (first >= pMode->data1[0] && first <= pMode->data2[0]) {
 			++score;
@@ -198,19 +479,23 @@ void eradicate2_score_leadingrange(const uchar * const hash, __global result * c
 		}
 	}
 
-	eradicate2_result_update(hash, pResult, score, scoreMax, deviceIndex, round);
+	return score;
 }
 
-void eradicate2_score_mirror(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round) {
+uchar eradicate2_score_mirror(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round) {
 	const size_t id = get_global_id(0);
 	int score = 0;
 
+	#pragma unroll
 	for (int i = 0; i < 10; ++i) {
-		const uchar leftLeft = (hash[9 - i] & 0xF0) >> 4;
-		const uchar leftRight = (hash[9 - i] & 0x0F);
+		const uchar left = eradicate2_address_byte(q1, q2, q3, 9 - i);
+		const uchar right = eradicate2_address_byte(q1, q2, q3, 10 + i);
 
-		const uchar rightLeft = (hash[10 + i] & 0xF0) >> 4;
-		const uchar rightRight = (hash[10 + i] & 0x0F);
+		const uchar leftLeft = (left & 0xF0) >> 4;
+		const uchar leftRight = (left & 0x0F);
+
+		const uchar rightLeft = (right & 0xF0) >> 4;
+		const uchar rightRight = (right & 0x0F);
 
 		if (leftRight != rightLeft) {
 			break;
@@ -225,15 +510,18 @@ void eradicate2_score_mirror(const uchar * const hash, __global result * const p
 		++score;
 	}
 
-	eradicate2_result_update(hash, pResult, score, scoreMax, deviceIndex, round);
+	return score;
 }
 
-void eradicate2_score_doubles(const uchar * const hash, __global result * const pResult, __global const mode * const pMode, const uchar scoreMax, const uint deviceIndex, const uint round) {
+uchar eradicate2_score_doubles(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, const uint deviceIndex, const uint round) {
 	const size_t id = get_global_id(0);
 	int score = 0;
 
+	#pragma unroll
 	for (int i = 0; i < 20; ++i) {
-		if ((hash[i] == 0x00) || (hash[i] == 0x11) || (hash[i] == 0x22) || (hash[i] == 0x33) || (hash[i] == 0x44) || (hash[i] == 0x55) || (hash[i] == 0x66) || (hash[i] == 0x77) || (hash[i] == 0x88) || (hash[i] == 0x99) || (hash[i] == 0xAA) || (hash[i] == 0xBB) || (hash[i] == 0xCC) || (hash[i] == 0xDD) || (hash[i] == 0xEE) || (hash[i] == 0xFF)) {
+		const uchar b = eradicate2_address_byte(q1, q2, q3, i);
+
+		if ((b >> 4) == (b & 0x0F)) {
 			++score;
 		}
 		else {
@@ -241,5 +529,31 @@ void eradicate2_score_doubles(const uchar * const hash, __global result * const
 		}
 	}
 
-	eradicate2_result_update(hash, pResult, score, scoreMax, deviceIndex, round);
+	return score;
+}
+
+// Gas saved, the same as SearchEngine::gasSaved(), in units of ERADICATE2_GAS_PER_SCORE so scores rank by cost savings.
+// Calldata costs 4 gas per zero byte and 16 per non-zero byte, and every leading zero byte makes the PUSH of the address one
+// byte shorter wherever it's embedded in code. With data1[0] set the zero bytes of the salt count as well, the host then
+// leaves the variable part of the salt outside of the counter zero so only the counter itself varies.
+uchar eradicate2_score_gas(const ulong q1, const ulong q2, const ulong q3, __global const mode * const pMode, __constant job * const pJob, const uint deviceIndex, const uint round) {
+	// Bytes are little endian within lanes so the leading bytes of the address are the low bytes of the upper half of q1
+	const ulong a0 = (q1 >> 32) | 0xFFFFFFFF00000000UL;
+	uint zeroBytes = eradicate2_zero_bytes(a0) + eradicate2_zero_bytes(q2) + eradicate2_zero_bytes(q3);
+
+	uint leading = eradicate2_ctz(a0) / 8;
+	if (leading == 4) {
+		leading += eradicate2_ctz(q2) / 8;
+		if (leading == 12) {
+			leading += eradicate2_ctz(q3) / 8;
+		}
+	}
+
+	if (pMode->data1[0]) {
+		const ulong lo = deviceIndex | ((ulong) get_global_id(0) << 32);
+		zeroBytes += pJob->saltZeroBytes + eradicate2_zero_bytes(lo) + eradicate2_zero_bytes((round + pJob->roundBase) | 0xFFFFFFFF00000000UL);
+	}
+
+	const uint gas = zeroBytes * ERADICATE2_GAS_ZERO_BYTE + leading * ERADICATE2_GAS_LEADING_BYTE;
+	return min(gas / ERADICATE2_GAS_PER_SCORE, (uint) ERADICATE2_MAX_SCORE);
 }
@@ -1,14 +1,21 @@
 #include <algorithm>
 #include <stdexcept>
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
+#include <csignal>
 #include <cstdio>
+#include <chrono>
+#include <memory>
+#include <numeric>
 #include <vector>
-#include <random>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <mutex>
 #include <map>
-#include <set>
 
 #if defined(__APPLE__) || defined(__MACOSX)
 #include <OpenCL/cl.h>
@@ -17,115 +24,187 @@
 #endif
 
 #include "hexadecimal.hpp"
-#include "Dispatcher.hpp"
+#include "SearchEngine.hpp"
+#include "Daemon.hpp"
 #include "ArgParser.hpp"
 #include "ModeFactory.hpp"
+#include "Calculator.hpp"
+#include "ResultStore.hpp"
+#include "SharedJob.hpp"
+#include "HostScorer.hpp"
 #include "types.hpp"
 #include "help.hpp"
-#include "sha3.hpp"
-
-std::string readFile(const char * const szFilename)
-{
-	std::ifstream in(szFilename, std::ios::in | std::ios::binary);
-	std::ostringstream contents;
-	contents << in.rdbuf();
-	return contents.str();
-}
 
-std::vector<cl_device_id> getAllDevices(cl_device_type deviceType = CL_DEVICE_TYPE_GPU)
-{
-	std::vector<cl_device_id> vDevices;
+static void printResult(const result r, const cl_uchar score, const mode & m, const std::string & strMode, const SearchEngine::Job & job, const std::string & strInitCode, const std::chrono::time_point<std::chrono::steady_clock> & timeStart) {
+	// Time delta
+	const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - timeStart).count();
 
-	cl_uint platformIdCount = 0;
-	clGetPlatformIDs (0, NULL, &platformIdCount);
+	// Format address, Safe jobs find a saltNonce the salt is derived from
+	std::string strSaltBinary(reinterpret_cast<const char *>(r.salt), 32);
+	if (!job.strSafeInitializerDigest.empty()) {
+		strSaltBinary = SearchEngine::safeSalt(job.strSafeInitializerDigest, strSaltBinary);
+	}
 
-	std::vector<cl_platform_id> platformIds (platformIdCount);
-	clGetPlatformIDs (platformIdCount, platformIds.data (), NULL);
+	const std::string strSalt = toHex(reinterpret_cast<const uint8_t *>(strSaltBinary.data()), 32);
+	const std::string strPublic = toHex(r.hash, 20);
 
-	for( auto it = platformIds.cbegin(); it != platformIds.cend(); ++it ) {
-		cl_uint countDevice;
-		clGetDeviceIDs(*it, deviceType, 0, NULL, &countDevice);
+	// Print
+	const std::string strVT100ClearLine = "\33[2K\r";
+	std::cout << strVT100ClearLine << "  Time: " << std::setw(5) << seconds << "s Score: " << std::setw(2) << (int) score;
+	if (!strMode.empty()) {
+		std::cout << " Mode: " << strMode;
+	}
+
+	if (!job.strSafeInitializerDigest.empty()) {
+		std::cout << " Salt nonce: 0x" << toHex(r.salt, 32);
+	}
 
-		std::vector<cl_device_id> deviceIds(countDevice);
-		clGetDeviceIDs(*it, deviceType, countDevice, deviceIds.data(), &countDevice);
+	std::cout << " Salt: 0x" << strSalt << " Address: 0x" << strPublic;
 
-		std::copy( deviceIds.begin(), deviceIds.end(), std::back_inserter(vDevices) );
+	// The variant of the init code field deploying to the address
+	if (job.initCodeVariableSize) {
+		std::cout << " Init code field: 0x" << toHex(reinterpret_cast<const uint8_t *>(strInitCode.data()) + job.initCodeVariableOffset, job.initCodeVariableSize);
 	}
 
-	return vDevices;
-}
+	if (job.bCreate3) {
+		const std::string strInitCodeDigest = job.initCodeVariableSize ? SearchEngine::keccakDigest(strInitCode) : job.strInitCodeDigest;
+		const std::string strProxy = SearchEngine::create2Address(job.strAddressBinary, strSaltBinary, strInitCodeDigest);
+		std::cout << " Proxy: 0x" << toHex(reinterpret_cast<const uint8_t *>(strProxy.data()), 20);
+	}
 
-template <typename T, typename U, typename V, typename W>
-T clGetWrapper(U function, V param, W param2) {
-	T t;
-	function(param, param2, sizeof(t), &t, NULL);
-	return t;
-}
+	if (m.function == ModeFunction::Gas) {
+		std::cout << " Gas: -" << SearchEngine::gasSaved(r, m.data1[0] != 0);
+	}
 
-template <typename U, typename V, typename W>
-std::string clGetWrapperString(U function, V param, W param2) {
-	size_t len;
-	function(param, param2, 0, NULL, &len);
-	char * const szString = new char[len];
-	function(param, param2, len, szString, NULL);
-	std::string r(szString);
-	delete[] szString;
-	return r;
+	std::cout << std::endl;
 }
 
-template <typename T, typename U, typename V, typename W>
-std::vector<T> clGetWrapperVector(U function, V param, W param2) {
-	size_t len;
-	function(param, param2, 0, NULL, &len);
-	len /= sizeof(T);
-	std::vector<T> v;
-	if (len > 0) {
-		T * pArray = new T[len];
-		function(param, param2, len * sizeof(T), pArray, NULL);
-		for (size_t i = 0; i < len; ++i) {
-			v.push_back(pArray[i]);
-		}
-		delete[] pArray;
+// Counts every mode once per hash and keeps every well populated bin within 6 standard deviations of the
+// theoretical distribution. A device that skips work or repeats salts fails one or the other. The distribution isn't known
+// when a constraint zeroes the scores of most hashes, only the count is checked then.
+static bool histogramCheck(const SearchEngine::Histogram & h, const std::vector<mode> & vModes, const std::vector<std::string> & vModeNames, const bool bConstraint, std::string & strProblem) {
+	for (size_t k = 0; k < vModes.size() && (k + 1) * (ERADICATE2_MAX_SCORE + 1) <= h.vCount.size(); ++k) {
+		const auto itBegin = h.vCount.begin() + k * (ERADICATE2_MAX_SCORE + 1);
+		const cl_ulong total = std::accumulate(itBegin, itBegin + ERADICATE2_MAX_SCORE + 1, cl_ulong(0));
+		if (total != h.hashes) {
+			strProblem = vModeNames[k] + " counted " + lexical_cast::write(total) + " of " + lexical_cast::write(h.hashes) + " hashes";
+			return false;
+		}
+
+		const std::vector<double> vP = bConstraint ? std::vector<double>() : ModeFactory::distribution(vModes[k], ERADICATE2_MAX_SCORE);
+		for (size_t i = 0; i < vP.size(); ++i) {
+			const double expected = vP[i] * h.hashes;
+			const double observed = static_cast<double>(itBegin[i]);
+
+			if (expected >= 50 && std::abs(observed - expected) > 6 * std::sqrt(expected * (1 - vP[i]))) {
+				std::ostringstream oss;
+				oss << vModeNames[k] << " score " << i << " seen " << itBegin[i] << " times, expected " << std::fixed << std::setprecision(0) << expected;
+				strProblem = oss.str();
+				return false;
+			}
+		}
 	}
-	return v;
+
+	return true;
 }
 
-std::vector<std::string> getBinaries(cl_program & clProgram) {
-	std::vector<std::string> vReturn;
-	auto vSizes = clGetWrapperVector<size_t>(clGetProgramInfo, clProgram, CL_PROGRAM_BINARY_SIZES);
-	if (!vSizes.empty()) {
-		unsigned char * * pBuffers = new unsigned char *[vSizes.size()];
-		for (size_t i = 0; i < vSizes.size(); ++i) {
-			pBuffers[i] = new unsigned char[vSizes[i]];
+// Hashes per result scoring at least each score, observed over all devices and expected
+static void printHistogram(const SearchEngine::Histogram & h, const std::vector<mode> & vModes, const std::vector<std::string> & vModeNames, const bool bConstraint) {
+	const std::string strVT100ClearLine = "\33[2K\r";
+	std::cout << strVT100ClearLine << "  Histogram after " << h.hashes << " hashes, hashes per result:" << std::endl;
+
+	for (size_t k = 0; k < vModes.size(); ++k) {
+		const std::vector<double> vP = bConstraint ? std::vector<double>() : ModeFactory::distribution(vModes[k], ERADICATE2_MAX_SCORE);
+		cl_ulong countTail = 0;
+		double pTail = 0;
+
+		for (size_t i = ERADICATE2_MAX_SCORE; i > 0; --i) {
+			countTail += h.vCount[k * (ERADICATE2_MAX_SCORE + 1) + i];
+			pTail += vP.empty() ? 0 : vP[i];
+
+			if (countTail > 0) {
+				std::cout << "    " << std::setw(16) << std::left << vModeNames[k] << std::right << " Score: " << std::setw(2) << i << " 1 in " << std::setw(12) << std::fixed << std::setprecision(0) << static_cast<double>(h.hashes) / countTail;
+				if (pTail > 0) {
+					std::cout << " expected 1 in " << 1 / pTail;
+				}
+
+				std::cout << std::endl;
+			}
 		}
+	}
+}
 
-		clGetProgramInfo(clProgram, CL_PROGRAM_BINARIES, vSizes.size() * sizeof(unsigned char *), pBuffers, NULL);
-		for (size_t i = 0; i < vSizes.size(); ++i) {
-			std::string strData(reinterpret_cast<char *>(pBuffers[i]), vSizes[i]);
-			vReturn.push_back(strData);
-			delete[] pBuffers[i];
+// Host round trip of every dispatch model with a kernel that does nothing, then the hash rate with the selected model. The
+// next round is queued before the results of the previous one are handled, so a round that is shorter than the round trip
+// leaves the device idle.
+static void benchmarkDispatch(SearchEngine & engine, const std::string & strDispatch, const size_t size) {
+	const unsigned int rounds = 1000;
+	std::map<size_t, double> mRoundTrip;
+
+	std::cout << "Dispatch round trip over " << rounds << " rounds:" << std::endl;
+	for (const std::string strModel : { "callback", "thread", "poll" }) {
+		const std::map<size_t, double> m = engine.benchmarkDispatch(strModel, rounds);
+		std::cout << "  " << std::setw(8) << std::left << strModel << std::right;
+		for (auto & p : m) {
+			std::cout << " GPU" << p.first << ": " << std::setw(8) << std::fixed << std::setprecision(1) << p.second * 1e6 << " us";
 		}
 
-		delete[] pBuffers;
+		std::cout << std::endl;
+		if (strModel == strDispatch) {
+			mRoundTrip = m;
+		}
 	}
 
-	return vReturn;
-}
+	SearchEngine::Job job;
+	job.strAddressBinary = std::string(20, '\0');
+	job.strInitCodeDigest = SearchEngine::keccakDigest("");
+	job.vModes.push_back(ModeFactory::benchmark());
+
+	std::map<size_t, double> mSpeed;
+	std::mutex mutexSpeed;
+	auto progressCallback = [&](const Speed & speed) {
+		std::lock_guard<std::mutex> lock(mutexSpeed);
+		for (auto & p : mRoundTrip) {
+			mSpeed[p.first] = speed.getSpeed(p.first);
+		}
+	};
+
+	std::cout << std::endl << "Measuring hash rate with the " << strDispatch << " model..." << std::endl;
+	engine.start(job, nullptr, progressCallback);
+	std::this_thread::sleep_for(std::chrono::seconds(5));
+	engine.stop();
+	engine.wait();
 
-template <typename T> bool printResult(const T & t, const cl_int & err) {
-	std::cout << ((t == NULL) ? lexical_cast::write(err) : "OK") << std::endl;
-	return t == NULL;
+	for (auto & p : mRoundTrip) {
+		const double speed = mSpeed[p.first];
+		std::cout << "  GPU" << p.first << ": " << std::fixed << std::setprecision(0) << speed << " H/s, a round of " << size << " takes " << (speed > 0 ? size / speed * 1e6 : 0) << " us, sizes below " << speed * p.second << " leave the device idle" << std::endl;
+	}
 }
 
-bool printResult(const cl_int err) {
-	std::cout << ((err != CL_SUCCESS) ? lexical_cast::write(err) : "OK") << std::endl;
-	return err != CL_SUCCESS;
+// With --trace, Ctrl-C ends the search instead of the process so the trace gets written. A second one ends the process.
+static SearchEngine * g_pEngineInterrupt = NULL;
+
+static void signalStop(int) {
+	signal(SIGINT, SIG_DFL);
+	if (g_pEngineInterrupt != NULL) {
+		g_pEngineInterrupt->stop();
+	}
 }
 
-std::string keccakDigest(const std::string data) {
-	char digest[32];
-	sha3(data.c_str(), data.size(), digest, 32);
-	return std::string(digest, 32);
+bool parseDeviceType(const std::string & strType, cl_device_type & deviceType) {
+	if (strType == "gpu") {
+		deviceType = CL_DEVICE_TYPE_GPU;
+	} else if (strType == "cpu") {
+		deviceType = CL_DEVICE_TYPE_CPU;
+	} else if (strType == "accelerator") {
+		deviceType = CL_DEVICE_TYPE_ACCELERATOR;
+	} else if (strType == "all") {
+		deviceType = CL_DEVICE_TYPE_ALL;
+	} else {
+		return false;
+	}
+
+	return true;
 }
 
 void trim(std::string & s) {
@@ -141,39 +220,6 @@ void trim(std::string & s) {
 	}
 }
 
-std::string makePreprocessorInitHashExpression(const std::string & strAddressBinary, const std::string & strInitCodeDigest) {
-	std::random_device rd;
-	std::mt19937_64 eng(rd());
-	std::uniform_int_distribution<unsigned int> distr; // C++ requires integer type: "C2338	note : char, signed char, unsigned char, int8_t, and uint8_t are not allowed"
-	ethhash h = { 0 };
-
-	h.b[0] = 0xff;
-	for (int i = 0; i < 20; ++i) {
-		h.b[i + 1] = strAddressBinary[i];
-	}
-
-	for (int i = 0; i < 32; ++i) {
-		h.b[i + 21] = distr(eng);
-	}
-
-	for (int i = 0; i < 32; ++i) {
-		h.b[i + 53] = strInitCodeDigest[i];
-	}
-
-	h.b[85] ^= 0x01;
-
-	std::ostringstream oss;
-	oss << std::hex;
-	for (int i = 0; i < 25; ++i) {
-		oss << "0x" << h.q[i];
-		if (i + 1 != 25) {
-			oss << ",";
-		}
-	}
-
-	return oss.str();
-}
-
 int main(int argc, char * * argv) {
 	try {
 		ArgParser argp(argc, argv);
@@ -189,6 +235,8 @@ int main(int argc, char * * argv) {
 		bool bModeRange = false;
 		bool bModeMirror = false;
 		bool bModeDoubles = false;
+		bool bModeGas = false;
+		bool bModeGasSalt = false;
 		int rangeMin = 0;
 		int rangeMax = 0;
 		std::vector<size_t> vDeviceSkipIndex;
@@ -198,6 +246,36 @@ int main(int argc, char * * argv) {
 		std::string strAddress;
 		std::string strInitCode;
 		std::string strInitCodeFile;
+		std::string strInitCodeHash;
+		bool bInitCodeRaw = false;
+		std::string strDeviceType = "gpu";
+		std::string strPartition;
+		std::string strKernelPath;
+		std::string strTrace;
+		std::string strDaemonSocket;
+		std::string strSaltTemplate;
+		std::string strInitCodeVariable;
+		std::string strSafeInitializer;
+		std::string strSafeSingleton;
+		std::string strConstraint;
+		std::string strCompute;
+		bool bComputeRaw = false;
+		std::string strStore;
+		bool bStoreQuery = false;
+		bool bShared = false;
+		int scoreTarget = 0;
+		bool bCreate3 = false;
+		bool bHistogram = false;
+		bool bNoVerify = false;
+		std::string strDispatch = "callback";
+		bool bDispatchBenchmark = false;
+		double dutyCycle = 100;
+		bool bYield = false;
+		std::vector<std::string> vScorer;
+		std::string strPrefilter;
+		int prefilterScore = 0;
+		size_t scorerThreads = 0;
+		std::vector<std::string> vKeccak;
 
 		argp.addSwitch('h', "help", bHelp);
 		argp.addSwitch('0', "benchmark", bModeBenchmark);
@@ -211,15 +289,47 @@ int main(int argc, char * * argv) {
 		argp.addSwitch('7', "range", bModeRange);
 		argp.addSwitch('8', "mirror", bModeMirror);
 		argp.addSwitch('9', "leading-doubles", bModeDoubles);
+		argp.addSwitch('g', "gas", bModeGas);
+		argp.addSwitch('G', "gas-salt", bModeGasSalt);
 		argp.addSwitch('m', "min", rangeMin);
 		argp.addSwitch('M', "max", rangeMax);
 		argp.addMultiSwitch('s', "skip", vDeviceSkipIndex);
+		argp.addSwitch('t', "device-type", strDeviceType);
+		argp.addSwitch('P', "partition", strPartition);
+		argp.addSwitch('L', "kernel-path", strKernelPath);
+		argp.addSwitch('R', "trace", strTrace);
+		argp.addMultiSwitch('K', "keccak", vKeccak);
+		argp.addSwitch('H', "histogram", bHistogram);
+		argp.addSwitch('N', "no-verify", bNoVerify);
+		argp.addSwitch('d', "dispatch", strDispatch);
+		argp.addSwitch('B', "dispatch-benchmark", bDispatchBenchmark);
+		argp.addSwitch('U', "duty-cycle", dutyCycle);
+		argp.addSwitch('E', "yield", bYield);
+		argp.addSwitch('D', "daemon", strDaemonSocket);
 		argp.addSwitch('w', "work", worksizeLocal);
 		argp.addSwitch('W', "work-max", worksizeMax);
 		argp.addSwitch('S', "size", size);
 		argp.addSwitch('A', "address", strAddress);
 		argp.addSwitch('I', "init-code", strInitCode);
 		argp.addSwitch('i', "init-code-file", strInitCodeFile);
+		argp.addSwitch('b', "init-code-raw", bInitCodeRaw);
+		argp.addSwitch('k', "init-code-hash", strInitCodeHash);
+		argp.addSwitch('T', "salt-template", strSaltTemplate);
+		argp.addSwitch('V', "init-code-variable", strInitCodeVariable);
+		argp.addSwitch('C', "create3", bCreate3);
+		argp.addSwitch('Y', "safe-initializer", strSafeInitializer);
+		argp.addSwitch('y', "safe-singleton", strSafeSingleton);
+		argp.addSwitch('u', "constraint", strConstraint);
+		argp.addMultiSwitch('x', "scorer", vScorer);
+		argp.addSwitch('f', "prefilter", strPrefilter);
+		argp.addSwitch('F', "prefilter-score", prefilterScore);
+		argp.addSwitch('j', "scorer-threads", scorerThreads);
+		argp.addSwitch('c', "compute", strCompute);
+		argp.addSwitch('r', "compute-raw", bComputeRaw);
+		argp.addSwitch('o', "store", strStore);
+		argp.addSwitch('q', "store-query", bStoreQuery);
+		argp.addSwitch('X', "target", scoreTarget);
+		argp.addSwitch('Z', "shared", bShared);
 
 		if (!argp.parse()) {
 			std::cout << "error: bad arguments, try again :<" << std::endl;
@@ -231,145 +341,421 @@ int main(int argc, char * * argv) {
 			return 0;
 		}
 
-		// Parse hexadecimal values and/or read init code from file
-		if (strInitCodeFile != "") {
-			std::ifstream ifs(strInitCodeFile);
+		// Parse hexadecimal values and/or hash the init code while reading it from file. The init code itself is only kept
+		// when a field of it is varied or the Safe singleton is appended to it.
+		const std::string strAddressBinary = parseHexadecimalBytes(strAddress);
+		std::string strInitCodeBinary;
+		std::string strInitCodeDigest;
+		const bool bInitCodeKeep = !strInitCodeVariable.empty() || !strSafeSingleton.empty();
+
+		if (!strInitCodeHash.empty()) {
+			strInitCodeDigest = parseHexadecimalBytes(strInitCodeHash);
+			if (strInitCodeDigest.size() != 32 || bInitCodeKeep) {
+				std::cout << "error: init code hash must be 32 bytes and can't be combined with --init-code-variable or --safe-singleton" << std::endl;
+				return 1;
+			}
+		} else if (strInitCodeFile != "") {
+			std::ifstream ifs(strInitCodeFile, std::ios::in | std::ios::binary);
 			if (!ifs.is_open()) {
 				std::cout << "error: failed to open input file for init code" << std::endl;
 				return 1;
 			}
-			strInitCode.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+
+			strInitCodeDigest = SearchEngine::keccakDigest(ifs, !bInitCodeRaw, bInitCodeKeep ? &strInitCodeBinary : NULL);
+		} else {
+			trim(strInitCode);
+			strInitCodeBinary = parseHexadecimalBytes(strInitCode);
+			strInitCodeDigest = SearchEngine::keccakDigest(strInitCodeBinary);
 		}
 
-		trim(strInitCode);
-		const std::string strAddressBinary = parseHexadecimalBytes(strAddress);
-		const std::string strInitCodeBinary = parseHexadecimalBytes(strInitCode);
-		const std::string strInitCodeDigest = keccakDigest(strInitCodeBinary);
-		const std::string strPreprocessorInitStructure = makePreprocessorInitHashExpression(strAddressBinary, strInitCodeDigest);
+		// The Safe ProxyFactory deploys the proxy creation code followed by the singleton address as a uint256
+		std::string strSafeInitializerDigest;
+		if (!strSafeSingleton.empty()) {
+			const std::string strSingletonBinary = parseHexadecimalBytes(strSafeSingleton);
+			if (strSingletonBinary.size() != 20) {
+				std::cout << "error: Safe singleton must be a 20 byte address" << std::endl;
+				return 1;
+			}
+
+			strInitCodeBinary += std::string(12, '\0') + strSingletonBinary;
+			strInitCodeDigest = SearchEngine::keccakDigest(strInitCodeBinary);
+		}
+
+		if (!strSafeInitializer.empty()) {
+			trim(strSafeInitializer);
+			if (!strSaltTemplate.empty() || !strInitCodeVariable.empty()) {
+				std::cout << "error: --safe-initializer can't be combined with --salt-template or --init-code-variable" << std::endl;
+				return 1;
+			}
+
+			strSafeInitializerDigest = SearchEngine::keccakDigest(parseHexadecimalBytes(strSafeInitializer));
+		}
+
+		if (!(dutyCycle > 0 && dutyCycle <= 100)) {
+			std::cout << "error: duty cycle must be a percentage above 0 and at most 100" << std::endl;
+			return 1;
+		}
+
+		SearchEngine::Config config;
+		if (!parseDeviceType(strDeviceType, config.deviceType)) {
+			std::cout << "error: unknown device type \"" << strDeviceType << "\"" << std::endl;
+			return 1;
+		}
+
+		config.vDeviceSkipIndex = vDeviceSkipIndex;
+		config.strPartition = strPartition;
+		config.strKernelPath = strKernelPath;
+		config.strTrace = strTrace;
+		config.worksizeLocal = worksizeLocal;
+		config.worksizeMax = worksizeMax;
+		config.size = size;
+		config.bHistogram = bHistogram;
+		config.strDispatch = strDispatch;
+		config.dutyCycle = dutyCycle / 100;
+		config.bYield = bYield;
+		config.scorerThreads = scorerThreads;
+		config.bVerify = !bNoVerify;
+		config.pLog = &std::cout;
+
+		// Either an implementation for all devices or <index>:<implementation> for a single device
+		for (auto & strKeccak : vKeccak) {
+			const size_t pos = strKeccak.find(':');
+			if (pos == std::string::npos) {
+				config.strKeccak = strKeccak;
+			} else {
+				config.mDeviceKeccak[lexical_cast::read<size_t>(strKeccak.substr(0, pos))] = strKeccak.substr(pos + 1);
+			}
+		}
+
+		SearchEngine engine(config);
+		if (!strDaemonSocket.empty()) {
+			engine.init();
+			Daemon daemon(engine, strDaemonSocket);
+			daemon.run();
+			return 0;
+		}
+
+		if (bDispatchBenchmark) {
+			engine.init();
+			benchmarkDispatch(engine, strDispatch, size);
+			return 0;
+		}
+
+		// Every selected mode scores the same hashes
+		std::vector<mode> vModes;
+		std::vector<std::string> vModeNames;
+		auto addMode = [&](const mode & m, const std::string & strName) { vModes.push_back(m); vModeNames.push_back(strName); };
 
-		mode mode = ModeFactory::benchmark();
 		if (bModeBenchmark) {
-			mode = ModeFactory::benchmark();
-		} else if (bModeZeroBytes) {
-			mode = ModeFactory::zerobytes();
-		}  else if (bModeZeros) {
-			mode = ModeFactory::zeros();
-		} else if (bModeLetters) {
-			mode = ModeFactory::letters();
-		} else if (bModeNumbers) {
-			mode = ModeFactory::numbers();
-		} else if (!strModeLeading.empty()) {
-			mode = ModeFactory::leading(strModeLeading.front());
-		} else if (!strModeMatching.empty()) {
-			mode = ModeFactory::matching(strModeMatching);
-		} else if (bModeLeadingRange) {
-			mode = ModeFactory::leadingRange(rangeMin, rangeMax);
-		} else if (bModeRange) {
-			mode = ModeFactory::range(rangeMin, rangeMax);
-		} else if(bModeMirror) {
-			mode = ModeFactory::mirror();
-		} else if (bModeDoubles) {
-			mode = ModeFactory::doubles();
-		} else {
+			addMode(ModeFactory::benchmark(), "benchmark");
+		}
+
+		if (bModeZeroBytes) {
+			addMode(ModeFactory::zerobytes(), "zero-bytes");
+		}
+
+		if (bModeZeros) {
+			addMode(ModeFactory::zeros(), "zeros");
+		}
+
+		if (bModeLetters) {
+			addMode(ModeFactory::letters(), "letters");
+		}
+
+		if (bModeNumbers) {
+			addMode(ModeFactory::numbers(), "numbers");
+		}
+
+		if (!strModeLeading.empty()) {
+			addMode(ModeFactory::leading(strModeLeading.front()), "leading");
+		}
+
+		if (!strModeMatching.empty()) {
+			addMode(ModeFactory::matching(strModeMatching), "matching");
+		}
+
+		if (bModeLeadingRange) {
+			addMode(ModeFactory::leadingRange(rangeMin, rangeMax), "leading-range");
+		}
+
+		if (bModeRange) {
+			addMode(ModeFactory::range(rangeMin, rangeMax), "range");
+		}
+
+		if (bModeMirror) {
+			addMode(ModeFactory::mirror(), "mirror");
+		}
+
+		if (bModeDoubles) {
+			addMode(ModeFactory::doubles(), "leading-doubles");
+		}
+
+		if (bModeGas || bModeGasSalt) {
+			addMode(ModeFactory::gas(bModeGasSalt), "gas");
+		}
+
+		// Addresses of known salts are computed on the host, every selected mode adds a score column
+		if (!strCompute.empty()) {
+			Calculator::Config configCalculator;
+			configCalculator.strAddressBinary = strAddressBinary;
+			configCalculator.strInitCodeDigest = strInitCodeDigest;
+			configCalculator.bCreate3 = bCreate3;
+			configCalculator.strSafeInitializerDigest = strSafeInitializerDigest;
+			configCalculator.vModes = vModes;
+			configCalculator.bRaw = bComputeRaw;
+			configCalculator.threads = scorerThreads;
+
+			std::ios::sync_with_stdio(false);
+			const auto timeCompute = std::chrono::steady_clock::now();
+			const cl_ulong count = Calculator(configCalculator).run(strCompute, std::cout);
+			std::cout.flush();
+
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeCompute).count();
+			std::cerr << "Computed " << count << " addresses in " << std::fixed << std::setprecision(2) << seconds << "s" << std::endl;
+			return 0;
+		}
+
+		// Host scorers only see the hashes passing the prefilter and report after the device modes
+		std::vector<std::shared_ptr<HostScorer>> vScorers;
+		std::vector<std::string> vScorerNames;
+		for (auto & strScorer : vScorer) {
+			const size_t pos = strScorer.find(':');
+			const std::string strName = strScorer.substr(0, pos);
+			vScorers.push_back(HostScorer::create(strName, pos == std::string::npos ? "" : strScorer.substr(pos + 1)));
+			vScorerNames.push_back(strName.substr(strName.find_last_of('/') + 1));
+		}
+
+		if (!vScorers.empty() && (strPrefilter.empty() || prefilterScore <= 0)) {
+			std::cout << "error: host scorers need --prefilter and --prefilter-score" << std::endl;
+			return 1;
+		}
+
+		if (vModes.empty() && !vScorers.empty()) {
+			addMode(ModeFactory::benchmark(), "benchmark");
+		}
+
+		if (vModes.empty()) {
 			std::cout << g_strHelp << std::endl;
 			return 0;
 		}
 
-		std::vector<cl_device_id> vFoundDevices = getAllDevices();
-		std::vector<cl_device_id> vDevices;
-		std::map<cl_device_id, size_t> mDeviceIndex;
+		SearchEngine::Job job;
+		job.strAddressBinary = strAddressBinary;
+		job.strInitCodeDigest = strInitCodeDigest;
+		job.vModes = vModes;
+		job.bCreate3 = bCreate3;
+		job.strSafeInitializerDigest = strSafeInitializerDigest;
+		if (!strConstraint.empty()) {
+			SearchEngine::parseConstraint(strConstraint, job.strConstraintMask, job.strConstraintValue);
+		}
 
-		std::vector<std::string> vDeviceBinary;
-		std::vector<size_t> vDeviceBinarySize;
-		cl_int errorCode;
+		if (!strSaltTemplate.empty()) {
+			SearchEngine::parseSaltTemplate(strSaltTemplate, job.strSaltTemplate, job.strSaltVariable);
+		}
 
-		std::cout << "Devices:" << std::endl;
-		for (size_t i = 0; i < vFoundDevices.size(); ++i) {
-			// Ignore devices in skip index
-			if (std::find(vDeviceSkipIndex.begin(), vDeviceSkipIndex.end(), i) != vDeviceSkipIndex.end()) {
-				continue;
+		if (!strInitCodeVariable.empty()) {
+			const size_t pos = strInitCodeVariable.find(':');
+			if (pos == std::string::npos) {
+				std::cout << "error: init code variable field must be given as <offset>:<size>" << std::endl;
+				return 1;
 			}
 
-			cl_device_id & deviceId = vFoundDevices[i];
+			job.strInitCode = strInitCodeBinary;
+			job.initCodeVariableOffset = lexical_cast::read<size_t>(strInitCodeVariable.substr(0, pos));
+			job.initCodeVariableSize = lexical_cast::read<size_t>(strInitCodeVariable.substr(pos + 1));
+		}
 
-			const auto strName = clGetWrapperString(clGetDeviceInfo, deviceId, CL_DEVICE_NAME);
-			const auto computeUnits = clGetWrapper<cl_uint>(clGetDeviceInfo, deviceId, CL_DEVICE_MAX_COMPUTE_UNITS);
-			const auto globalMemSize = clGetWrapper<cl_ulong>(clGetDeviceInfo, deviceId, CL_DEVICE_GLOBAL_MEM_SIZE);
+		if (!vScorers.empty()) {
+			const size_t pos = strPrefilter.find(':');
+			job.candidateMode = ModeFactory::parse(strPrefilter.substr(0, pos), pos == std::string::npos ? "" : strPrefilter.substr(pos + 1), rangeMin, rangeMax);
+			job.candidateScore = static_cast<cl_uchar>(std::min(prefilterScore, ERADICATE2_MAX_SCORE));
+			job.vScorers = vScorers;
+		}
 
-			std::cout << "  GPU" << i << ": " << strName << ", " << globalMemSize << " bytes available, " << computeUnits << " compute units" << std::endl;
-			vDevices.push_back(vFoundDevices[i]);
-			mDeviceIndex[vFoundDevices[i]] = i;
+		if (scoreTarget > 0) {
+			job.scoreTarget = static_cast<cl_uchar>(std::min(scoreTarget, ERADICATE2_MAX_SCORE));
 		}
 
-		if (vDevices.empty()) {
+		// Results of host scorers follow those of the modes
+		std::vector<std::string> vResultNames = vModeNames;
+		vResultNames.insert(vResultNames.end(), vScorerNames.begin(), vScorerNames.end());
+		const mode modeHost = ModeFactory::benchmark();
+		std::vector<int> vScoreBest(vResultNames.size(), 0);
+
+		// Results of earlier runs of the same job are only beaten, not found again. Host scorer results aren't stored.
+		std::unique_ptr<ResultStore> pStore;
+		std::vector<std::string> vStoreKeys;
+		if (!strStore.empty()) {
+			pStore.reset(new ResultStore(strStore));
+			for (size_t i = 0; i < vModes.size(); ++i) {
+				vStoreKeys.push_back(ResultStore::key(job, vModes[i]));
+				job.vScoreMax.push_back(std::max(job.scoreMax, pStore->best(vStoreKeys[i])));
+				vScoreBest[i] = job.vScoreMax[i];
+			}
+
+			if (bStoreQuery) {
+				for (size_t i = 0; i < vModes.size(); ++i) {
+					std::cout << vModeNames[i] << ":" << std::endl;
+					for (auto & e : pStore->top(vStoreKeys[i])) {
+						std::cout << "  Score: " << std::setw(2) << static_cast<int>(e.score) << " Salt: 0x" << toHex(reinterpret_cast<const uint8_t *>(e.strSalt.data()), e.strSalt.size()) << " Address: 0x" << toHex(reinterpret_cast<const uint8_t *>(e.strAddress.data()), e.strAddress.size()) << std::endl;
+					}
+				}
+
+				return 0;
+			}
+
+			for (size_t i = 0; i < vModes.size(); ++i) {
+				if (job.scoreTarget > 0 && job.vScoreMax[i] >= job.scoreTarget) {
+					std::cout << "Target already reached by " << vModeNames[i] << " with score " << static_cast<int>(job.vScoreMax[i]) << ", see --store-query" << std::endl;
+					return 0;
+				}
+			}
+		} else if (bStoreQuery) {
+			std::cout << "error: --store-query needs --store" << std::endl;
 			return 1;
 		}
 
-		std::cout << std::endl;
-		std::cout << "Initializing OpenCL..." << std::endl;
-		std::cout << "  Creating context..." << std::flush;
-		auto clContext = clCreateContext( NULL, vDevices.size(), vDevices.data(), NULL, NULL, &errorCode);
-		if (printResult(clContext, errorCode)) {
-			return 1;
+		engine.init();
+
+		// Processes on this host running the same job split the salts between them and only report results beating all
+		// of them. The slot is claimed once the devices are ready, compiling and testing them can take longer than a slot
+		// stays alive without a heartbeat.
+		std::unique_ptr<SharedJob> pShared;
+		if (bShared) {
+			pShared.reset(new SharedJob(job));
+			job.seed = pShared->seed();
+			job.deviceIndexBase = pShared->deviceIndexBase();
+			if (job.vScoreMax.empty()) {
+				job.vScoreMax.assign(vModes.size(), job.scoreMax);
+			}
+
+			for (size_t i = 0; i < vModes.size(); ++i) {
+				pShared->publish(i, job.vScoreMax[i]);
+				job.vScoreMax[i] = std::max(job.vScoreMax[i], pShared->best(i));
+				vScoreBest[i] = job.vScoreMax[i];
+			}
+
+			std::cout << "Shared job " << SharedJob::name(job) << ", device indexes from " << job.deviceIndexBase << std::endl;
 		}
 
-		cl_program clProgram;
-		if (vDeviceBinary.size() == vDevices.size()) {
-			// Create program from binaries
-			std::cout << "  Loading kernel from binary..." << std::flush;
-			const unsigned char * * pKernels = new const unsigned char *[vDevices.size()];
-			for (size_t i = 0; i < vDeviceBinary.size(); ++i) {
-				pKernels[i] = reinterpret_cast<const unsigned char *>(vDeviceBinary[i].data());
+		std::cout << "Running..." << std::endl;
+		std::cout << std::endl;
+
+		const auto timeStart = std::chrono::steady_clock::now();
+		std::mutex mutexScoreBest;
+		auto resultCallback = [&](const result & r, const cl_uchar score, const size_t modeIndex, const size_t deviceIndex) {
+			// Device and host scorer results arrive from different threads
+			std::lock_guard<std::mutex> lock(mutexScoreBest);
+			vScoreBest[modeIndex] = score;
+			if (pStore && modeIndex < vStoreKeys.size()) {
+				pStore->add(vStoreKeys[modeIndex], r, score);
 			}
 
-			cl_int * pStatus = new cl_int[vDevices.size()];
+			if (pShared && modeIndex < vModes.size()) {
+				pShared->publish(modeIndex, score);
+			}
 
-			clProgram = clCreateProgramWithBinary(clContext, vDevices.size(), vDevices.data(), vDeviceBinarySize.data(), pKernels, pStatus, &errorCode);
-			if(printResult(clProgram, errorCode)) {
-				return 1;
+			printResult(r, score, modeIndex < vModes.size() ? vModes[modeIndex] : modeHost, vResultNames.size() > 1 ? vResultNames[modeIndex] : "", job, engine.initCode(r), timeStart);
+		};
+
+		// With several modes the status line also shows the best score of each. With --histogram it shows whether the
+		// score distribution of every device is healthy and the observed hit rates are printed once a minute. Results
+		// may be delivered holding the engine's lock so mutexScoreBest mustn't be held while querying the engine.
+		std::vector<bool> vHistogramBad(engine.devices().size(), false);
+		auto timeHistogram = timeStart;
+		std::mutex mutexHistogram;
+		std::atomic<bool> bSharedLost(false);
+		auto progressCallback = [&](const Speed & speed) {
+			std::ostringstream oss;
+
+			// The best scores of the other processes become those the devices must beat. A process that lost its slot
+			// would hash the salts of whoever took it over.
+			if (pShared) {
+				if (!pShared->heartbeat(speed.getSpeed())) {
+					bSharedLost = true;
+					engine.stop();
+					return;
+				}
+
+				for (size_t i = 0; i < vModes.size(); ++i) {
+					engine.raiseScoreMax(i, pShared->best(i));
+				}
+
+				std::lock_guard<std::mutex> lock(mutexScoreBest);
+				for (size_t i = 0; i < vModes.size(); ++i) {
+					vScoreBest[i] = std::max<int>(vScoreBest[i], pShared->best(i));
+				}
 			}
-		} else {
-			// Create a program from the kernel source
-			std::cout << "  Compiling kernel..." << std::flush;
-			const std::string strKeccak = readFile("keccak.cl");
-			const std::string strVanity = readFile("eradicate2.cl");
-			const char * szKernels[] = { strKeccak.c_str(), strVanity.c_str() };
-
-			clProgram = clCreateProgramWithSource(clContext, sizeof(szKernels) / sizeof(char *), szKernels, NULL, &errorCode);
-			if (printResult(clProgram, errorCode)) {
-				return 1;
+
+			{
+				std::lock_guard<std::mutex> lock(mutexScoreBest);
+				for (size_t i = 0; i < vResultNames.size() && vResultNames.size() > 1; ++i) {
+					oss << (i == 0 ? " Best:" : "") << " " << vResultNames[i] << " " << vScoreBest[i];
+				}
 			}
-		}
 
-		// Build the program
-		std::cout << "  Building program..." << std::flush;
+			if (pShared) {
+				size_t processes;
+				const double speedShared = pShared->speedTotal(processes);
+				oss << " Shared: " << processes << " processes " << std::fixed << std::setprecision(3) << speedShared / 1e6 << " MH/s";
+			}
 
-		const std::string strBuildOptions = "-D ERADICATE2_MAX_SCORE=" + lexical_cast::write(ERADICATE2_MAX_SCORE) + " -D ERADICATE2_INITHASH=" + strPreprocessorInitStructure;
-		if (printResult(clBuildProgram(clProgram, vDevices.size(), vDevices.data(), strBuildOptions.c_str(), NULL, NULL))) {
-#ifdef ERADICATE2_DEBUG
-			std::cout << std::endl;
-			std::cout << "build log:" << std::endl;
+			if (!vScorers.empty()) {
+				cl_ulong scored, dropped;
+				size_t backlog;
+				engine.candidateStats(scored, dropped, backlog);
+				oss << " Candidates: " << scored << " scored " << dropped << " dropped " << backlog << " queued";
+			}
 
-			size_t sizeLog;
-			clGetProgramBuildInfo(clProgram, vDevices[0], CL_PROGRAM_BUILD_LOG, 0, NULL, &sizeLog);
-			char * const szLog = new char[sizeLog];
-			clGetProgramBuildInfo(clProgram, vDevices[0], CL_PROGRAM_BUILD_LOG, sizeLog, szLog, NULL);
+			if (bHistogram) {
+				std::lock_guard<std::mutex> lock(mutexHistogram);
+				SearchEngine::Histogram hTotal;
+				hTotal.vCount.assign((ERADICATE2_MAX_SCORE + 1) * vModes.size(), 0);
+				std::string strBad;
+
+				for (size_t i = 0; i < engine.devices().size(); ++i) {
+					const size_t index = engine.devices()[i].index;
+					const SearchEngine::Histogram h = engine.histogram(index);
+					std::string strProblem;
+
+					if (!histogramCheck(h, vModes, vModeNames, !job.strConstraintMask.empty(), strProblem)) {
+						strBad += " GPU" + lexical_cast::write(index);
+						if (!vHistogramBad[i]) {
+							vHistogramBad[i] = true;
+							std::cout << "\33[2K\r  warning: GPU" << index << " histogram: " << strProblem << std::endl;
+						}
+					}
+
+					hTotal.hashes += h.hashes;
+					for (size_t j = 0; j < h.vCount.size() && j < hTotal.vCount.size(); ++j) {
+						hTotal.vCount[j] += h.vCount[j];
+					}
+				}
+
+				oss << " Histogram:" << (strBad.empty() ? " ok" : strBad);
+
+				if (std::chrono::steady_clock::now() - timeHistogram >= std::chrono::minutes(1)) {
+					timeHistogram = std::chrono::steady_clock::now();
+					printHistogram(hTotal, vModes, vModeNames, !job.strConstraintMask.empty());
+				}
+			}
 
-			std::cout << szLog << std::endl;
-			delete[] szLog;
-#endif
-			return 1;
+			speed.print(oss.str());
+		};
+
+		if (!strTrace.empty()) {
+			g_pEngineInterrupt = &engine;
+			signal(SIGINT, signalStop);
 		}
 
-		std::cout << std::endl;
+		engine.start(job, resultCallback, progressCallback);
+		engine.wait();
 
-		Dispatcher d(clContext, clProgram, worksizeMax == 0 ? size : worksizeMax, size);
-		for (auto & i : vDevices) {
-			d.addDevice(i, worksizeLocal, mDeviceIndex[i]);
+		if (bSharedLost) {
+			std::cout << std::endl << "error: shared job slot was taken over by another process after missing heartbeats" << std::endl;
+			return 1;
 		}
 
-		d.run(mode);
-		clReleaseContext(clContext);
 		return 0;
 	} catch (std::runtime_error & e) {
 		std::cout << "std::runtime_error - " << e.what() << std::endl;
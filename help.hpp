@@ -10,11 +10,49 @@ usage: ./ERADICATE2 [OPTIONS]
     -A, --address           Target address
     -I, --init-code         Init code
     -i, --init-code-file    Read init code from this file
+    -b, --init-code-raw     The init code file holds raw bytes
+    -k, --init-code-hash    Keccak-256 of the init code, instead of the init
+                            code itself
+    -T, --salt-template <template>
+                            Salt with fixed bytes, variable bytes written as
+                            xx. Bytes left out at the end are variable, at
+                            least 12 consecutive bytes must be variable.
+                            Example for a factory requiring the caller in
+                            the salt: -T 0x<20 byte caller address>
+    -C, --create3           Score the CREATE3 address, the contract deployed
+                            with CREATE at nonce 1 by the CREATE2 address.
+                            The init code is that of the proxy. Results also
+                            show the proxy address.
+    -V, --init-code-variable <offset>:<size>
+                            Vary <size> bytes of the init code starting at
+                            byte <offset> instead of the salt, e.g. a
+                            constructor argument. The field must be at least
+                            12 bytes, its last 12 bytes hold the counter and
+                            the rest is random. The salt stays fixed and
+                            results show the field. Not with --gas-salt.
+    -Y, --safe-initializer <hex>
+                            Safe ProxyFactory createProxyWithNonce: the salt
+                            is keccak256(keccak256(initializer) ++ saltNonce)
+                            and the search varies saltNonce instead, at about
+                            half the speed. -A is the factory and the init
+                            code is the proxy creation code. Results show the
+                            salt nonce and the salt. Not with --salt-template
+                            or --init-code-variable.
+    -y, --safe-singleton <address>
+                            Append the singleton as a uint256 to the init
+                            code, as the Safe ProxyFactory does.
+    -u, --constraint <mask>:<value>
+                            Only score addresses whose bits under <mask>
+                            equal those of <value>, both numbers of at most
+                            160 bits. All other addresses score 0 in every
+                            mode. Example for a Uniswap v4 hook with the
+                            beforeSwap and afterSwap flags: -u 0x3fff:0xc0
 
     The init code should be expressed as a hexadecimal string having the
     prefix 0x both when expressed on the command line with -I and in the
-    file pointed to by -i if used. Any whitespace will be trimmed. If no
-    init code is specified it defaults to an empty string.
+    file pointed to by -i if used, unless -b is given. Any whitespace will
+    be trimmed. If no init code is specified it defaults to an empty string.
+    Init code files are hashed while they're read, they can be of any size.
 
   Basic modes:
     --benchmark             Run without any scoring, a benchmark.
@@ -24,6 +62,13 @@ usage: ./ERADICATE2 [OPTIONS]
     --numbers               Score on numbers anywhere in hash.
     --mirror                Score on mirroring from center.
     --leading-doubles       Score on hashes leading with hexadecimal pairs
+    --gas                   Score on gas saved by the address, 12 per zero
+                            byte of calldata and 200 per leading zero byte of
+                            code, one point per 32 gas. Results show the gas
+                            saved.
+    --gas-salt              Like --gas but zero bytes of the salt count too.
+                            The variable part of the salt is then zero apart
+                            from the 12 byte counter.
 
   Modes with arguments:
     --leading <single hex>  Score on hashes leading with given hex character.
@@ -35,22 +80,152 @@ usage: ./ERADICATE2 [OPTIONS]
     --range                 Scores on hashes having characters within given
                             range anywhere.
 
+    Up to 8 modes can be given at once, every hash is then scored by all of
+    them and results and the status line show the mode.
+
+  Host scoring:
+    -x, --scorer <name[:arg]>
+                            Score hashes passing the prefilter again on the
+                            host. Built in are words:<file>, characters
+                            covered by hexadecimal words from a list, and
+                            regex:<pattern>, length of the first match in
+                            the address. A name containing a / loads a
+                            shared library exporting eradicate2_scorer_create.
+                            Can be given multiple times.
+    -f, --prefilter <mode[:arg]>
+                            Device mode selecting the hashes to score on the
+                            host, e.g. leading:0 or matching:dead.
+    -F, --prefilter-score <score>
+                            Minimum prefilter score of hashes scored on the
+                            host. Keep it selective enough for the scorer
+                            threads to keep up, the status line shows how
+                            many candidates were scored and dropped.
+    -j, --scorer-threads <count>
+                            Host scorer and --compute threads.
+                            [default = hardware threads]
+
+  Computing addresses:
+    -c, --compute <file>    Compute the addresses of known salts on the host
+                            instead of searching, - reads standard input.
+                            Input has a 32 byte hexadecimal salt at the start
+                            of every line, the rest of the line is ignored.
+                            Output is a line of salt and address per salt,
+                            followed by the score of every selected mode.
+                            With --safe-initializer the salts are saltNonces.
+    -r, --compute-raw       Input is raw 32 byte salts. Files are memory
+                            mapped.
+
+  Results store:
+    -o, --store <file>      Keep the 16 best results of every job and mode in
+                            this file across runs. A job is its address, init
+                            code, --create3, the Safe initializer, the
+                            constraint and the mode with its arguments.
+                            Only results beating the best stored score of
+                            their mode are reported. Not with
+                            --init-code-variable.
+    -q, --store-query       Print the stored results of the job instead of
+                            searching.
+    -X, --target <score>    Stop once a result reaches this score. With
+                            --store a job that already reached it isn't run.
+    -Z, --shared            Share the job with the other processes on this
+                            host running it with --shared, e.g. one per GPU.
+                            They never hash the same salt, only report
+                            results beating the best of all of them and show
+                            their combined speed. Uses POSIX shared memory
+                            named after the job.
+
   Range:
     -m, --min <0-15>        Set range minimum (inclusive), 0 is '0' 15 is 'f'.
     -M, --max <0-15>        Set range maximum (inclusive), 0 is '0' 15 is 'f'.
 
   Device control:
     -s, --skip <index>      Skip device given by index.
+    -t, --device-type <type>
+                            Use devices of given type: gpu, cpu, accelerator
+                            or all. [default = gpu]
+    -P, --partition <numa|count>
+                            Split CPU devices into sub-devices, one per NUMA
+                            node or of <count> compute units each. Every
+                            sub-device gets its own queue, buffers and speed
+                            and is numbered after all devices.
+    -K, --keccak <impl>     Keccak-f implementation, loop, unrolled,
+                            bitselect, complement or interleaved. Prefix
+                            with a device index and colon to only change
+                            that device, e.g. -K 1:interleaved. Can be given
+                            multiple times. [default = loop]
+    -d, --dispatch <model>  Where the host handles finished rounds: callback
+                            runs on OpenCL event callbacks, thread on a host
+                            thread per device and poll on a single host
+                            thread polling all devices. [default = callback]
+    -B, --dispatch-benchmark
+                            Measure the host round trip of every dispatch
+                            model with a kernel that does nothing, then the
+                            hash rate with the selected model and the
+                            smallest -S that keeps the devices busy.
+    -U, --duty-cycle <percent>
+                            Keep each device busy only this share of the
+                            time, leaving the rest to other work. Rounds
+                            are cut to 20 ms and followed by idle time sized
+                            from their kernel durations measured by OpenCL
+                            profiling, so the hash rate is that share of the
+                            full rate. Implies --dispatch thread.
+                            [default = 100]
+    -E, --yield             Back off while other work is running on a
+                            device, noticed by its rounds taking longer per
+                            hash than the fastest one. Rounds are cut to
+                            20 ms as with --duty-cycle, which it can be
+                            combined with. Implies --dispatch thread.
+    -L, --kernel-path <dir> Compile keccak.cl and eradicate2.cl from this
+                            directory instead of the kernels embedded in the
+                            executable.
+    -R, --trace <file>      Record a timeline of every round: kernels and
+                            result reads timed by OpenCL profiling, and the
+                            host dispatch, lock waits, result and progress
+                            callbacks. Written to <file> in Chrome trace
+                            format when the search ends, for Perfetto or
+                            chrome://tracing. Ctrl-C ends the search.
+
+  Daemon:
+    -D, --daemon <path>     Initialize all devices once and serve jobs from a
+                            Unix domain socket at given path. Requests and
+                            events are newline separated JSON objects:
+                              {"op":"submit","address":"0x..","initCode":"0x..",
+                               "mode":"leading","arg":"0","target":8,
+                               "deadline":60,"priority":1}
+                              {"op":"cancel","job":1}
+                              {"op":"status"}
+                            "initCodeHash" may be given instead of "initCode",
+                            "mode" may list several modes separated by commas
+                            with an optional :<arg> each, e.g. "zeros,leading:0",
+                            "min"/"max" set the range of the range modes,
+                            "create3":true scores the CREATE3 address,
+                            "safeInitializer" searches Safe saltNonces and
+                            results then also hold "saltNonce", "constraint"
+                            takes <mask>:<value> like --constraint. A
+                            job with higher priority preempts the running one.
+                            Events are echoed on standard output.
 
   Tweaking:
     -w, --work <size>       Set OpenCL local work size. [default = 64]
     -W, --work-max <size>   Set OpenCL maximum work size. [default = -i * -I]
     -S, --size <size>       Set number of salts tried per loop.
                             [default = 16777216]
+    -H, --histogram         Count the score of every hash on the devices. The
+                            status line shows whether the scores of each
+                            device follow the expected distribution, a
+                            device that skips or repeats work fails. The
+                            observed hashes per result are printed once a
+                            minute. With --constraint only the number of
+                            hashes is checked.
+    -N, --no-verify         Skip the known-answer test of every device at
+                            startup and the host check of every result. By
+                            default a device computing a wrong salt, address
+                            or score is excluded and its results dropped.
 
   Examples:
     ./ERADICATE2 -A 0x00000000000000000000000000000000deadbeef -I 0x00 --leading 0
     ./ERADICATE2 -A 0x00000000000000000000000000000000deadbeef -I 0x00 --zeros
+    ./ERADICATE2 -A 0x00000000000000000000000000000000deadbeef -I 0x00 -c salts.txt --zeros
 
   About:
     ERADICATE2 is a vanity address generator for CREATE2 addresses that
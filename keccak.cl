@@ -97,11 +97,358 @@ __constant ulong keccakf_rndc[24] = {
 	0x8000000000008080, 0x0000000080000001, 0x8000000080008008
 };
 
+#if defined(ERADICATE2_KECCAK_INTERLEAVED)
+// Bit interleaved, every lane is held as two 32 bit words with its even and odd bits so a 64 bit rotation becomes two 32 bit
+// rotations. For devices without native 64 bit rotate. Converting in and out costs a bit but is done once per permutation.
+#define KECCAK_ROUND_INTERLEAVED(Ae, Ao, Ee, Eo, rce, rco) \
+{ \
+	ce0 = Ae[0] ^ Ae[5] ^ Ae[10] ^ Ae[15] ^ Ae[20];          \
+	co0 = Ao[0] ^ Ao[5] ^ Ao[10] ^ Ao[15] ^ Ao[20];          \
+	ce1 = Ae[1] ^ Ae[6] ^ Ae[11] ^ Ae[16] ^ Ae[21];          \
+	co1 = Ao[1] ^ Ao[6] ^ Ao[11] ^ Ao[16] ^ Ao[21];          \
+	ce2 = Ae[2] ^ Ae[7] ^ Ae[12] ^ Ae[17] ^ Ae[22];          \
+	co2 = Ao[2] ^ Ao[7] ^ Ao[12] ^ Ao[17] ^ Ao[22];          \
+	ce3 = Ae[3] ^ Ae[8] ^ Ae[13] ^ Ae[18] ^ Ae[23];          \
+	co3 = Ao[3] ^ Ao[8] ^ Ao[13] ^ Ao[18] ^ Ao[23];          \
+	ce4 = Ae[4] ^ Ae[9] ^ Ae[14] ^ Ae[19] ^ Ae[24];          \
+	co4 = Ao[4] ^ Ao[9] ^ Ao[14] ^ Ao[19] ^ Ao[24];          \
+	de0 = ce4 ^ rotate(co1, 1u);                             \
+	do0 = co4 ^ ce1;                                         \
+	de1 = ce0 ^ rotate(co2, 1u);                             \
+	do1 = co0 ^ ce2;                                         \
+	de2 = ce1 ^ rotate(co3, 1u);                             \
+	do2 = co1 ^ ce3;                                         \
+	de3 = ce2 ^ rotate(co4, 1u);                             \
+	do3 = co2 ^ ce4;                                         \
+	de4 = ce3 ^ rotate(co0, 1u);                             \
+	do4 = co3 ^ ce0;                                         \
+	te = Ae[0] ^ de0; to = Ao[0] ^ do0;                      \
+	be0 = te; bo0 = to;                                      \
+	te = Ae[6] ^ de1; to = Ao[6] ^ do1;                      \
+	be1 = rotate(te, 22u); bo1 = rotate(to, 22u);            \
+	te = Ae[12] ^ de2; to = Ao[12] ^ do2;                    \
+	be2 = rotate(to, 22u); bo2 = rotate(te, 21u);            \
+	te = Ae[18] ^ de3; to = Ao[18] ^ do3;                    \
+	be3 = rotate(to, 11u); bo3 = rotate(te, 10u);            \
+	te = Ae[24] ^ de4; to = Ao[24] ^ do4;                    \
+	be4 = rotate(te, 7u); bo4 = rotate(to, 7u);              \
+	Ee[0] = be0 ^ ((~be1) & be2) ^ rce;                      \
+	Eo[0] = bo0 ^ ((~bo1) & bo2) ^ rco;                      \
+	Ee[1] = be1 ^ ((~be2) & be3);                            \
+	Eo[1] = bo1 ^ ((~bo2) & bo3);                            \
+	Ee[2] = be2 ^ ((~be3) & be4);                            \
+	Eo[2] = bo2 ^ ((~bo3) & bo4);                            \
+	Ee[3] = be3 ^ ((~be4) & be0);                            \
+	Eo[3] = bo3 ^ ((~bo4) & bo0);                            \
+	Ee[4] = be4 ^ ((~be0) & be1);                            \
+	Eo[4] = bo4 ^ ((~bo0) & bo1);                            \
+	te = Ae[3] ^ de3; to = Ao[3] ^ do3;                      \
+	be0 = rotate(te, 14u); bo0 = rotate(to, 14u);            \
+	te = Ae[9] ^ de4; to = Ao[9] ^ do4;                      \
+	be1 = rotate(te, 10u); bo1 = rotate(to, 10u);            \
+	te = Ae[10] ^ de0; to = Ao[10] ^ do0;                    \
+	be2 = rotate(to, 2u); bo2 = rotate(te, 1u);              \
+	te = Ae[16] ^ de1; to = Ao[16] ^ do1;                    \
+	be3 = rotate(to, 23u); bo3 = rotate(te, 22u);            \
+	te = Ae[22] ^ de2; to = Ao[22] ^ do2;                    \
+	be4 = rotate(to, 31u); bo4 = rotate(te, 30u);            \
+	Ee[5] = be0 ^ ((~be1) & be2);                            \
+	Eo[5] = bo0 ^ ((~bo1) & bo2);                            \
+	Ee[6] = be1 ^ ((~be2) & be3);                            \
+	Eo[6] = bo1 ^ ((~bo2) & bo3);                            \
+	Ee[7] = be2 ^ ((~be3) & be4);                            \
+	Eo[7] = bo2 ^ ((~bo3) & bo4);                            \
+	Ee[8] = be3 ^ ((~be4) & be0);                            \
+	Eo[8] = bo3 ^ ((~bo4) & bo0);                            \
+	Ee[9] = be4 ^ ((~be0) & be1);                            \
+	Eo[9] = bo4 ^ ((~bo0) & bo1);                            \
+	te = Ae[1] ^ de1; to = Ao[1] ^ do1;                      \
+	be0 = rotate(to, 1u); bo0 = te;                          \
+	te = Ae[7] ^ de2; to = Ao[7] ^ do2;                      \
+	be1 = rotate(te, 3u); bo1 = rotate(to, 3u);              \
+	te = Ae[13] ^ de3; to = Ao[13] ^ do3;                    \
+	be2 = rotate(to, 13u); bo2 = rotate(te, 12u);            \
+	te = Ae[19] ^ de4; to = Ao[19] ^ do4;                    \
+	be3 = rotate(te, 4u); bo3 = rotate(to, 4u);              \
+	te = Ae[20] ^ de0; to = Ao[20] ^ do0;                    \
+	be4 = rotate(te, 9u); bo4 = rotate(to, 9u);              \
+	Ee[10] = be0 ^ ((~be1) & be2);                           \
+	Eo[10] = bo0 ^ ((~bo1) & bo2);                           \
+	Ee[11] = be1 ^ ((~be2) & be3);                           \
+	Eo[11] = bo1 ^ ((~bo2) & bo3);                           \
+	Ee[12] = be2 ^ ((~be3) & be4);                           \
+	Eo[12] = bo2 ^ ((~bo3) & bo4);                           \
+	Ee[13] = be3 ^ ((~be4) & be0);                           \
+	Eo[13] = bo3 ^ ((~bo4) & bo0);                           \
+	Ee[14] = be4 ^ ((~be0) & be1);                           \
+	Eo[14] = bo4 ^ ((~bo0) & bo1);                           \
+	te = Ae[4] ^ de4; to = Ao[4] ^ do4;                      \
+	be0 = rotate(to, 14u); bo0 = rotate(te, 13u);            \
+	te = Ae[5] ^ de0; to = Ao[5] ^ do0;                      \
+	be1 = rotate(te, 18u); bo1 = rotate(to, 18u);            \
+	te = Ae[11] ^ de1; to = Ao[11] ^ do1;                    \
+	be2 = rotate(te, 5u); bo2 = rotate(to, 5u);              \
+	te = Ae[17] ^ de2; to = Ao[17] ^ do2;                    \
+	be3 = rotate(to, 8u); bo3 = rotate(te, 7u);              \
+	te = Ae[23] ^ de3; to = Ao[23] ^ do3;                    \
+	be4 = rotate(te, 28u); bo4 = rotate(to, 28u);            \
+	Ee[15] = be0 ^ ((~be1) & be2);                           \
+	Eo[15] = bo0 ^ ((~bo1) & bo2);                           \
+	Ee[16] = be1 ^ ((~be2) & be3);                           \
+	Eo[16] = bo1 ^ ((~bo2) & bo3);                           \
+	Ee[17] = be2 ^ ((~be3) & be4);                           \
+	Eo[17] = bo2 ^ ((~bo3) & bo4);                           \
+	Ee[18] = be3 ^ ((~be4) & be0);                           \
+	Eo[18] = bo3 ^ ((~bo4) & bo0);                           \
+	Ee[19] = be4 ^ ((~be0) & be1);                           \
+	Eo[19] = bo4 ^ ((~bo0) & bo1);                           \
+	te = Ae[2] ^ de2; to = Ao[2] ^ do2;                      \
+	be0 = rotate(te, 31u); bo0 = rotate(to, 31u);            \
+	te = Ae[8] ^ de3; to = Ao[8] ^ do3;                      \
+	be1 = rotate(to, 28u); bo1 = rotate(te, 27u);            \
+	te = Ae[14] ^ de4; to = Ao[14] ^ do4;                    \
+	be2 = rotate(to, 20u); bo2 = rotate(te, 19u);            \
+	te = Ae[15] ^ de0; to = Ao[15] ^ do0;                    \
+	be3 = rotate(to, 21u); bo3 = rotate(te, 20u);            \
+	te = Ae[21] ^ de1; to = Ao[21] ^ do1;                    \
+	be4 = rotate(te, 1u); bo4 = rotate(to, 1u);              \
+	Ee[20] = be0 ^ ((~be1) & be2);                           \
+	Eo[20] = bo0 ^ ((~bo1) & bo2);                           \
+	Ee[21] = be1 ^ ((~be2) & be3);                           \
+	Eo[21] = bo1 ^ ((~bo2) & bo3);                           \
+	Ee[22] = be2 ^ ((~be3) & be4);                           \
+	Eo[22] = bo2 ^ ((~bo3) & bo4);                           \
+	Ee[23] = be3 ^ ((~be4) & be0);                           \
+	Eo[23] = bo3 ^ ((~bo4) & bo0);                           \
+	Ee[24] = be4 ^ ((~be0) & be1);                           \
+	Eo[24] = bo4 ^ ((~bo0) & bo1);                           \
+}
+
+// Round constants split into even and odd bits, pairs of (even, odd)
+__constant uint keccakf_rndc_interleaved[48] = {
+	0x00000001, 0x00000000, 0x00000000, 0x00000089, 0x00000000, 0x8000008b,
+	0x00000000, 0x80008080, 0x00000001, 0x0000008b, 0x00000001, 0x00008000,
+	0x00000001, 0x80008088, 0x00000001, 0x80000082, 0x00000000, 0x0000000b,
+	0x00000000, 0x0000000a, 0x00000001, 0x00008082, 0x00000000, 0x00008003,
+	0x00000001, 0x0000808b, 0x00000001, 0x8000000b, 0x00000001, 0x8000008a,
+	0x00000001, 0x80000081, 0x00000000, 0x80000081, 0x00000000, 0x80000008,
+	0x00000000, 0x00000083, 0x00000000, 0x80008003, 0x00000001, 0x80008088,
+	0x00000000, 0x80000088, 0x00000001, 0x00008000, 0x00000000, 0x80008082
+};
+
+uint keccakf_interleave(ulong x)
+{
+	x &= 0x5555555555555555UL;
+	x = (x | (x >> 1)) & 0x3333333333333333UL;
+	x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FUL;
+	x = (x | (x >> 4)) & 0x00FF00FF00FF00FFUL;
+	x = (x | (x >> 8)) & 0x0000FFFF0000FFFFUL;
+	x = (x | (x >> 16)) & 0x00000000FFFFFFFFUL;
+	return (uint) x;
+}
+
+ulong keccakf_deinterleave(const uint v)
+{
+	ulong x = v;
+	x = (x | (x << 16)) & 0x0000FFFF0000FFFFUL;
+	x = (x | (x << 8)) & 0x00FF00FF00FF00FFUL;
+	x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FUL;
+	x = (x | (x << 2)) & 0x3333333333333333UL;
+	x = (x | (x << 1)) & 0x5555555555555555UL;
+	return x;
+}
+
+void keccakf(ulong * const st)
+{
+	uint ae[25], ao[25], ee[25], eo[25];
+	uint ce0, ce1, ce2, ce3, ce4, co0, co1, co2, co3, co4;
+	uint de0, de1, de2, de3, de4, do0, do1, do2, do3, do4;
+	uint be0, be1, be2, be3, be4, bo0, bo1, bo2, bo3, bo4;
+	uint te, to;
+
+	#pragma unroll
+	for (int i = 0; i < 25; ++i) {
+		ae[i] = keccakf_interleave(st[i]);
+		ao[i] = keccakf_interleave(st[i] >> 1);
+	}
+
+	#pragma unroll
+	for (int i = 0; i < 24; i += 2) {
+		KECCAK_ROUND_INTERLEAVED(ae, ao, ee, eo, keccakf_rndc_interleaved[2 * i], keccakf_rndc_interleaved[2 * i + 1]);
+		KECCAK_ROUND_INTERLEAVED(ee, eo, ae, ao, keccakf_rndc_interleaved[2 * i + 2], keccakf_rndc_interleaved[2 * i + 3]);
+	}
+
+	#pragma unroll
+	for (int i = 0; i < 25; ++i) {
+		st[i] = keccakf_deinterleave(ae[i]) | (keccakf_deinterleave(ao[i]) << 1);
+	}
+}
+#elif defined(ERADICATE2_KECCAK_UNROLLED) || defined(ERADICATE2_KECCAK_BITSELECT) || defined(ERADICATE2_KECCAK_COMPLEMENT)
+// Fully unrolled with PI folded into the indexing, every round reads one array and writes the other so no lane is ever moved.
+#ifdef ERADICATE2_KECCAK_BITSELECT
+#define CHI(a, b, c) bitselect((a) ^ (c), (a), (b))
+#else
+#define CHI(a, b, c) ((a) ^ ((~(b)) & (c)))
+#endif
+
+#define KECCAK_ROUND(A, E, rc) \
+{ \
+	c0 = A[0] ^ A[5] ^ A[10] ^ A[15] ^ A[20];                \
+	c1 = A[1] ^ A[6] ^ A[11] ^ A[16] ^ A[21];                \
+	c2 = A[2] ^ A[7] ^ A[12] ^ A[17] ^ A[22];                \
+	c3 = A[3] ^ A[8] ^ A[13] ^ A[18] ^ A[23];                \
+	c4 = A[4] ^ A[9] ^ A[14] ^ A[19] ^ A[24];                \
+	d0 = c4 ^ rotate(c1, (ulong) 1);                         \
+	d1 = c0 ^ rotate(c2, (ulong) 1);                         \
+	d2 = c1 ^ rotate(c3, (ulong) 1);                         \
+	d3 = c2 ^ rotate(c4, (ulong) 1);                         \
+	d4 = c3 ^ rotate(c0, (ulong) 1);                         \
+	b0 = A[0] ^ d0;                                          \
+	b1 = rotate(A[6] ^ d1, (ulong) 44);                      \
+	b2 = rotate(A[12] ^ d2, (ulong) 43);                     \
+	b3 = rotate(A[18] ^ d3, (ulong) 21);                     \
+	b4 = rotate(A[24] ^ d4, (ulong) 14);                     \
+	E[0] = CHI(b0, b1, b2) ^ rc;                             \
+	E[1] = CHI(b1, b2, b3);                                  \
+	E[2] = CHI(b2, b3, b4);                                  \
+	E[3] = CHI(b3, b4, b0);                                  \
+	E[4] = CHI(b4, b0, b1);                                  \
+	b0 = rotate(A[3] ^ d3, (ulong) 28);                      \
+	b1 = rotate(A[9] ^ d4, (ulong) 20);                      \
+	b2 = rotate(A[10] ^ d0, (ulong) 3);                      \
+	b3 = rotate(A[16] ^ d1, (ulong) 45);                     \
+	b4 = rotate(A[22] ^ d2, (ulong) 61);                     \
+	E[5] = CHI(b0, b1, b2);                                  \
+	E[6] = CHI(b1, b2, b3);                                  \
+	E[7] = CHI(b2, b3, b4);                                  \
+	E[8] = CHI(b3, b4, b0);                                  \
+	E[9] = CHI(b4, b0, b1);                                  \
+	b0 = rotate(A[1] ^ d1, (ulong) 1);                       \
+	b1 = rotate(A[7] ^ d2, (ulong) 6);                       \
+	b2 = rotate(A[13] ^ d3, (ulong) 25);                     \
+	b3 = rotate(A[19] ^ d4, (ulong) 8);                      \
+	b4 = rotate(A[20] ^ d0, (ulong) 18);                     \
+	E[10] = CHI(b0, b1, b2);                                 \
+	E[11] = CHI(b1, b2, b3);                                 \
+	E[12] = CHI(b2, b3, b4);                                 \
+	E[13] = CHI(b3, b4, b0);                                 \
+	E[14] = CHI(b4, b0, b1);                                 \
+	b0 = rotate(A[4] ^ d4, (ulong) 27);                      \
+	b1 = rotate(A[5] ^ d0, (ulong) 36);                      \
+	b2 = rotate(A[11] ^ d1, (ulong) 10);                     \
+	b3 = rotate(A[17] ^ d2, (ulong) 15);                     \
+	b4 = rotate(A[23] ^ d3, (ulong) 56);                     \
+	E[15] = CHI(b0, b1, b2);                                 \
+	E[16] = CHI(b1, b2, b3);                                 \
+	E[17] = CHI(b2, b3, b4);                                 \
+	E[18] = CHI(b3, b4, b0);                                 \
+	E[19] = CHI(b4, b0, b1);                                 \
+	b0 = rotate(A[2] ^ d2, (ulong) 62);                      \
+	b1 = rotate(A[8] ^ d3, (ulong) 55);                      \
+	b2 = rotate(A[14] ^ d4, (ulong) 39);                     \
+	b3 = rotate(A[15] ^ d0, (ulong) 41);                     \
+	b4 = rotate(A[21] ^ d1, (ulong) 2);                      \
+	E[20] = CHI(b0, b1, b2);                                 \
+	E[21] = CHI(b1, b2, b3);                                 \
+	E[22] = CHI(b2, b3, b4);                                 \
+	E[23] = CHI(b3, b4, b0);                                 \
+	E[24] = CHI(b4, b0, b1);                                 \
+}
+
+// Lane complementing, lanes 1, 2, 8, 12, 17 and 20 are kept inverted which turns most of the NOTs in CHI into ORs.
+#define KECCAK_ROUND_COMPLEMENT(A, E, rc) \
+{ \
+	c0 = A[0] ^ A[5] ^ A[10] ^ A[15] ^ A[20];                \
+	c1 = A[1] ^ A[6] ^ A[11] ^ A[16] ^ A[21];                \
+	c2 = A[2] ^ A[7] ^ A[12] ^ A[17] ^ A[22];                \
+	c3 = A[3] ^ A[8] ^ A[13] ^ A[18] ^ A[23];                \
+	c4 = A[4] ^ A[9] ^ A[14] ^ A[19] ^ A[24];                \
+	d0 = c4 ^ rotate(c1, (ulong) 1);                         \
+	d1 = c0 ^ rotate(c2, (ulong) 1);                         \
+	d2 = c1 ^ rotate(c3, (ulong) 1);                         \
+	d3 = c2 ^ rotate(c4, (ulong) 1);                         \
+	d4 = c3 ^ rotate(c0, (ulong) 1);                         \
+	b0 = A[0] ^ d0;                                          \
+	b1 = rotate(A[6] ^ d1, (ulong) 44);                      \
+	b2 = rotate(A[12] ^ d2, (ulong) 43);                     \
+	b3 = rotate(A[18] ^ d3, (ulong) 21);                     \
+	b4 = rotate(A[24] ^ d4, (ulong) 14);                     \
+	E[0] = b0 ^ (b1 | b2) ^ rc;                              \
+	E[1] = b1 ^ (~b2 | b3);                                  \
+	E[2] = b2 ^ (b3 & b4);                                   \
+	E[3] = b3 ^ (b4 | b0);                                   \
+	E[4] = b4 ^ (b0 & b1);                                   \
+	b0 = rotate(A[3] ^ d3, (ulong) 28);                      \
+	b1 = rotate(A[9] ^ d4, (ulong) 20);                      \
+	b2 = rotate(A[10] ^ d0, (ulong) 3);                      \
+	b3 = rotate(A[16] ^ d1, (ulong) 45);                     \
+	b4 = rotate(A[22] ^ d2, (ulong) 61);                     \
+	E[5] = b0 ^ (b1 | b2);                                   \
+	E[6] = b1 ^ (b2 & b3);                                   \
+	E[7] = b2 ^ (b3 | ~b4);                                  \
+	E[8] = b3 ^ (b4 | b0);                                   \
+	E[9] = b4 ^ (b0 & b1);                                   \
+	b0 = rotate(A[1] ^ d1, (ulong) 1);                       \
+	b1 = rotate(A[7] ^ d2, (ulong) 6);                       \
+	b2 = rotate(A[13] ^ d3, (ulong) 25);                     \
+	b3 = rotate(A[19] ^ d4, (ulong) 8);                      \
+	b4 = rotate(A[20] ^ d0, (ulong) 18);                     \
+	E[10] = b0 ^ (b1 | b2);                                  \
+	E[11] = b1 ^ (b2 & b3);                                  \
+	E[12] = b2 ^ (~b3 & b4);                                 \
+	E[13] = ~b3 ^ (b4 | b0);                                 \
+	E[14] = b4 ^ (b0 & b1);                                  \
+	b0 = rotate(A[4] ^ d4, (ulong) 27);                      \
+	b1 = rotate(A[5] ^ d0, (ulong) 36);                      \
+	b2 = rotate(A[11] ^ d1, (ulong) 10);                     \
+	b3 = rotate(A[17] ^ d2, (ulong) 15);                     \
+	b4 = rotate(A[23] ^ d3, (ulong) 56);                     \
+	E[15] = b0 ^ (b1 & b2);                                  \
+	E[16] = b1 ^ (b2 | b3);                                  \
+	E[17] = b2 ^ (~b3 | b4);                                 \
+	E[18] = ~b3 ^ (b4 & b0);                                 \
+	E[19] = b4 ^ (b0 | b1);                                  \
+	b0 = rotate(A[2] ^ d2, (ulong) 62);                      \
+	b1 = rotate(A[8] ^ d3, (ulong) 55);                      \
+	b2 = rotate(A[14] ^ d4, (ulong) 39);                     \
+	b3 = rotate(A[15] ^ d0, (ulong) 41);                     \
+	b4 = rotate(A[21] ^ d1, (ulong) 2);                      \
+	E[20] = b0 ^ (~b1 & b2);                                 \
+	E[21] = ~b1 ^ (b2 | b3);                                 \
+	E[22] = b2 ^ (b3 & b4);                                  \
+	E[23] = b3 ^ (b4 | b0);                                  \
+	E[24] = b4 ^ (b0 & b1);                                  \
+}
+
+void keccakf(ulong * const st)
+{
+	ulong e[25];
+	ulong c0, c1, c2, c3, c4, d0, d1, d2, d3, d4, b0, b1, b2, b3, b4;
+
+#ifdef ERADICATE2_KECCAK_COMPLEMENT
+	st[1] = ~st[1]; st[2] = ~st[2]; st[8] = ~st[8]; st[12] = ~st[12]; st[17] = ~st[17]; st[20] = ~st[20];
+#endif
+
+	#pragma unroll
+	for (int i = 0; i < 24; i += 2) {
+#ifdef ERADICATE2_KECCAK_COMPLEMENT
+		KECCAK_ROUND_COMPLEMENT(st, e, keccakf_rndc[i]);
+		KECCAK_ROUND_COMPLEMENT(e, st, keccakf_rndc[i + 1]);
+#else
+		KECCAK_ROUND(st, e, keccakf_rndc[i]);
+		KECCAK_ROUND(e, st, keccakf_rndc[i + 1]);
+#endif
+	}
+
+#ifdef ERADICATE2_KECCAK_COMPLEMENT
+	st[1] = ~st[1]; st[2] = ~st[2]; st[8] = ~st[8]; st[12] = ~st[12]; st[17] = ~st[17]; st[20] = ~st[20];
+#endif
+}
+#else
+// Permutation only, st must only ever be indexed with constants so the compiler keeps all 25 lanes in registers.
 // Barely a bottleneck. No need to tinker more.
-void sha3_keccakf(ethhash * const h)
+void keccakf(ulong * const st)
 {
-	ulong * const st = h->q;
-	h->d[33] ^= 0x80000000;
 	ulong t0, t1, t2, t3, t4, t5;
 
 	// Unrolling and removing PI stage gave negligable performance on GTX 1070.
@@ -112,3 +459,10 @@ void sha3_keccakf(ethhash * const h)
 		IOTA(st[0], keccakf_rndc[i]);
 	}
 }
+#endif
+
+void sha3_keccakf(ethhash * const h)
+{
+	h->d[33] ^= 0x80000000;
+	keccakf(h->q);
+}
@@ -0,0 +1,16 @@
+#ifndef HPP_KERNELS
+#define HPP_KERNELS
+
+#include <cstddef>
+
+/* Kernels embedded in the executable. kernels.cpp is generated by the Makefile from keccak.cl and eradicate2.cl, and
+ * from eradicate2.spv if it was built with "make spirv". The SPIR-V is compiled offline with g_szKernelILOptions and can
+ * only replace the source when the runtime build options are the same.
+ */
+extern const char * const g_szKeccakSource;
+extern const char * const g_szEradicate2Source;
+extern const unsigned char g_kernelIL[];
+extern const size_t g_kernelILSize; // 0 when built without SPIR-V
+extern const char * const g_szKernelILOptions;
+
+#endif /* HPP_KERNELS */
@@ -80,8 +80,9 @@ void sha3_keccakf(uint64_t st[25])
 		for (i = 0; i < 5; i++)
 			bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
 
+		// neighbour indices without % 5 so the compiler can unroll, the host computes millions of addresses with this
 		for (i = 0; i < 5; i++) {
-			t = bc[(i + 4) % 5] ^ ROTL64(bc[(i + 1) % 5], 1);
+			t = bc[i == 0 ? 4 : i - 1] ^ ROTL64(bc[i == 4 ? 0 : i + 1], 1);
 			for (j = 0; j < 25; j += 5)
 				st[j + i] ^= t;
 		}
@@ -99,8 +100,11 @@ void sha3_keccakf(uint64_t st[25])
 		for (j = 0; j < 25; j += 5) {
 			for (i = 0; i < 5; i++)
 				bc[i] = st[j + i];
-			for (i = 0; i < 5; i++)
-				st[j + i] ^= (~bc[(i + 1) % 5]) & bc[(i + 2) % 5];
+			st[j] ^= (~bc[1]) & bc[2];
+			st[j + 1] ^= (~bc[2]) & bc[3];
+			st[j + 2] ^= (~bc[3]) & bc[4];
+			st[j + 3] ^= (~bc[4]) & bc[0];
+			st[j + 4] ^= (~bc[0]) & bc[1];
 		}
 
 		//  Iota
@@ -11,7 +11,7 @@
 #endif
 
 enum class ModeFunction {
-	Benchmark, ZeroBytes, Matching, Leading, Range, Mirror, Doubles, LeadingRange
+	Benchmark, ZeroBytes, Matching, Leading, Range, Mirror, Doubles, LeadingRange, Gas
 };
 
 typedef struct {
@@ -24,6 +24,9 @@ typedef struct {
 typedef struct {
 	cl_uchar salt[32];
 	cl_uchar hash[20];
+	cl_uint deviceIndex;
+	cl_uint id;
+	cl_uint round;
 	cl_uint found;
 } result;
 #pragma pack(pop)
@@ -34,4 +37,28 @@ typedef union {
 	cl_uint d[50];
 } ethhash;
 
+typedef struct {
+	ethhash init;
+	ethhash initCodeMidstate;
+	ethhash safeSalt;
+	cl_ulong constraintMask[3];
+	cl_ulong constraintValue[3];
+	cl_uint saltOffset;
+	cl_uint create3;
+	cl_uint modeCount;
+	cl_uint candidateScore;
+	cl_uint candidateMax;
+	cl_uint initCodeBlocks;
+	cl_uint initCodeCounterOffset;
+	cl_uint safe;
+	cl_uint saltZeroBytes;
+	cl_uint roundBase;
+} job;
+
+typedef struct {
+	cl_uint deviceIndex;
+	cl_uint id;
+	cl_uint round;
+} candidate;
+
 #endif /* HPP_TYPES */
\ No newline at end of file